@@ -0,0 +1,427 @@
+/* Copyright (c) 2017 Kewin Rausch
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Empower Agent simulator UE churn module.
+ */
+
+#include <inttypes.h>
+#include <math.h>
+#include <string.h>
+#include <time.h>
+
+#include "emsim.h"
+
+#define LOG_CHURN(x, ...)	LOG_TRACE(x, ##__VA_ARGS__)
+
+/* Departures which can be pending; UEs removed by someone else leave their
+ * departure in the queue until it expires, hence the margin.
+ */
+#define CHURN_DEP_MAX		(UE_MAX * 2)
+
+/* Interval between two statistics logs, in us. */
+#define CHURN_STATS_INT		1000000ULL
+
+/* Departure of an UE attached by the generator. */
+typedef struct __em_sim_churn_dep {
+	/* Time of the departure, in us since the start. */
+	u64 t;
+	/* UE which shall leave. */
+	u64 imsi;
+	u16 rnti;
+} em_churn_dep;
+
+/* Latency of one kind of operation over a statistics interval. */
+typedef struct __em_sim_churn_lat {
+	u64 nof;
+	u64 sum;
+	u64 max;
+} em_churn_lat;
+
+/******************************************************************************
+ * Globals used all around the simulator:                                     *
+ ******************************************************************************/
+
+em_churn sim_churn = {
+	.active    = 0,
+	.rate      = 0.0f,
+	.hold      = CHURN_HOLD_EXP,
+	.hold_a    = CHURN_HOLD_DEFAULT,
+	.hold_b    = CHURN_HOLD_DEFAULT,
+	.imsi_base = CHURN_IMSI_BASE_DEFAULT,
+	.imsi_nof  = CHURN_IMSI_NOF_DEFAULT,
+	.plmn      = {0x00101},
+	.nof_plmn  = 1,
+	.seed      = 1,
+};
+
+/* Min-heap of the pending departures, ordered by time. */
+em_churn_dep    churn_deps[CHURN_DEP_MAX];
+u32             churn_nof_deps = 0;
+
+/* Time of the next arrival, in us since the start. */
+u64             churn_next = 0;
+/* Moment the generator started. */
+struct timespec churn_t0;
+
+/* Next IMSI of the pool, as offset from the base. */
+u32             churn_imsi = 0;
+/* Next PLMN of the pool. */
+u32             churn_plmn = 0;
+
+/* State of the private random generator. */
+u32             churn_seed = 1;
+
+/* Statistics of the current interval. */
+u64             churn_stats_t   = 0;
+u64             churn_stats_add = 0;
+u64             churn_stats_rem = 0;
+em_churn_lat    churn_lat_add;
+em_churn_lat    churn_lat_rem;
+
+/******************************************************************************
+ * Private procedures for churn module only:                                  *
+ ******************************************************************************/
+
+/* Returns the time elapsed since 'from', in us. */
+static inline u64 churn_us(struct timespec * from)
+{
+	struct timespec t;
+
+	clock_gettime(CLOCK_MONOTONIC, &t);
+
+	return (u64)(t.tv_sec - from->tv_sec) * 1000000 +
+		(t.tv_nsec - from->tv_nsec) / 1000;
+}
+
+/* Returns a random number in (0, 1]. */
+static inline sp churn_random(void)
+{
+	churn_seed ^= churn_seed << 13;
+	churn_seed ^= churn_seed >> 17;
+	churn_seed ^= churn_seed << 5;
+
+	return ((churn_seed >> 8) + 1) * (1.0f / 16777216.0f);
+}
+
+/* Returns an holding time, in us, following the configured distribution. */
+u64 churn_holding(void)
+{
+	sp ms;
+
+	switch(sim_churn.hold) {
+	case CHURN_HOLD_FIXED:
+		ms = sim_churn.hold_a;
+		break;
+	case CHURN_HOLD_UNIFORM:
+		ms = sim_churn.hold_a +
+			(sim_churn.hold_b - sim_churn.hold_a) * churn_random();
+		break;
+	default:
+		ms = -sim_churn.hold_a * logf(churn_random());
+		break;
+	}
+
+	return ms > 0.0f ? (u64)(ms * 1000.0f) : 0;
+}
+
+/* Accounts the latency of an operation started at 's'. */
+static inline void churn_lat(em_churn_lat * l, struct timespec * s)
+{
+	u64 d = churn_us(s);
+
+	l->nof++;
+	l->sum += d;
+
+	if(d > l->max) {
+		l->max = d;
+	}
+}
+
+/* Inserts a departure in the heap. */
+int churn_dep_push(u64 t, u16 rnti, u64 imsi)
+{
+	u32          i;
+	u32          p;
+	em_churn_dep d = {t, imsi, rnti};
+
+	if(churn_nof_deps == CHURN_DEP_MAX) {
+		return -1;
+	}
+
+	for(i = churn_nof_deps++; i > 0; i = p) {
+		p = (i - 1) / 2;
+
+		if(churn_deps[p].t <= t) {
+			break;
+		}
+
+		churn_deps[i] = churn_deps[p];
+	}
+
+	churn_deps[i] = d;
+
+	return 0;
+}
+
+/* Removes the earliest departure from the heap. */
+void churn_dep_pop(void)
+{
+	u32          i = 0;
+	u32          c;
+	em_churn_dep d = churn_deps[--churn_nof_deps];
+
+	for(;;) {
+		c = i * 2 + 1;
+
+		if(c >= churn_nof_deps) {
+			break;
+		}
+
+		if(c + 1 < churn_nof_deps && churn_deps[c + 1].t < churn_deps[c].t) {
+			c++;
+		}
+
+		if(d.t <= churn_deps[c].t) {
+			break;
+		}
+
+		churn_deps[i] = churn_deps[c];
+		i = c;
+	}
+
+	churn_deps[i] = d;
+}
+
+/* An UE arrives at time 't'. */
+void churn_arrive(u64 t)
+{
+	int             u;
+	u32             plmn;
+	u64             imsi;
+	struct timespec s;
+
+	imsi = sim_churn.imsi_base + churn_imsi;
+	plmn = sim_churn.plmn[churn_plmn];
+
+	churn_imsi = (churn_imsi + 1) % sim_churn.imsi_nof;
+	churn_plmn = (churn_plmn + 1) % sim_churn.nof_plmn;
+
+	clock_gettime(CLOCK_MONOTONIC, &s);
+
+	u = ue_add(
+		sim_phy.cells[0].pci,
+		sim_phy.cells[0].DL_earfcn,
+		UE_RNTI_INVALID,
+		plmn,
+		imsi,
+		1);
+
+	churn_lat(&churn_lat_add, &s);
+
+	if(u == ERR_UE_ADD_FULL) {
+		sim_churn.nof_block++;
+		return;
+	}
+
+	if(u < 0) {
+		sim_churn.nof_fail++;
+		return;
+	}
+
+	sim_churn.nof_add++;
+	churn_stats_add++;
+
+	/* No room to track it; do not leave it there forever. */
+	if(churn_dep_push(t + churn_holding(), sim_ues[u].rnti, imsi)) {
+		ue_rem(sim_ues[u].rnti, 1);
+		sim_churn.nof_fail++;
+	}
+}
+
+/* The earliest UE of the queue leaves. */
+void churn_depart(void)
+{
+	int             u = ue_find_imsi(churn_deps[0].imsi);
+	u16             r = churn_deps[0].rnti;
+	struct timespec s;
+
+	churn_dep_pop();
+
+	/* Already left, by hand-over or by hand. */
+	if(u < 0 || sim_ues[u].rnti != r) {
+		return;
+	}
+
+	clock_gettime(CLOCK_MONOTONIC, &s);
+
+	if(ue_rem(r, 1)) {
+		sim_churn.nof_fail++;
+		return;
+	}
+
+	churn_lat(&churn_lat_rem, &s);
+
+	sim_churn.nof_rem++;
+	churn_stats_rem++;
+}
+
+/* Logs the statistics of the interval which ends at 'now', and starts a new
+ * one.
+ */
+void churn_stats(u64 now)
+{
+	double s = (now - churn_stats_t) / 1000000.0;
+
+	LOG_CHURN("Churn: %.0f/%.0f arrivals/s, %.0f departures/s, "
+		"%"PRIu64" blocked, %"PRIu64" failed\n",
+		churn_stats_add / s,
+		sim_churn.rate,
+		churn_stats_rem / s,
+		sim_churn.nof_block,
+		sim_churn.nof_fail);
+
+	LOG_CHURN("Churn: add %"PRIu64"/%"PRIu64" us, "
+		"rem %"PRIu64"/%"PRIu64" us (avg/max)\n",
+		churn_lat_add.nof ? churn_lat_add.sum / churn_lat_add.nof : 0,
+		churn_lat_add.max,
+		churn_lat_rem.nof ? churn_lat_rem.sum / churn_lat_rem.nof : 0,
+		churn_lat_rem.max);
+
+	churn_stats_t   = now;
+	churn_stats_add = 0;
+	churn_stats_rem = 0;
+
+	memset(&churn_lat_add, 0, sizeof(em_churn_lat));
+	memset(&churn_lat_rem, 0, sizeof(em_churn_lat));
+}
+
+/******************************************************************************
+ * Public accessible procedures:                                              *
+ ******************************************************************************/
+
+int churn_hold_from_string(char * name)
+{
+	if(strcmp(name, "exp") == 0) {
+		return CHURN_HOLD_EXP;
+	}
+
+	if(strcmp(name, "fixed") == 0) {
+		return CHURN_HOLD_FIXED;
+	}
+
+	if(strcmp(name, "uniform") == 0) {
+		return CHURN_HOLD_UNIFORM;
+	}
+
+	return ERR_CHURN_HOLD_UNKNOWN;
+}
+
+char * churn_hold_to_string(u32 hold)
+{
+	switch(hold) {
+	case CHURN_HOLD_FIXED:
+		return "fixed";
+	case CHURN_HOLD_UNIFORM:
+		return "uniform";
+	}
+
+	return "exp";
+}
+
+int churn_start(void)
+{
+	if(sim_churn.rate <= 0.0f ||
+		sim_churn.imsi_nof == 0 ||
+		sim_churn.nof_plmn == 0) {
+
+		return ERR_CHURN_START_CONF;
+	}
+
+	/* Zero would stop the generator forever. */
+	churn_seed = sim_churn.seed ? sim_churn.seed : 1;
+
+	churn_nof_deps  = 0;
+	churn_imsi      = 0;
+	churn_plmn      = 0;
+	churn_stats_t   = 0;
+	churn_stats_add = 0;
+	churn_stats_rem = 0;
+
+	memset(&churn_lat_add, 0, sizeof(em_churn_lat));
+	memset(&churn_lat_rem, 0, sizeof(em_churn_lat));
+
+	clock_gettime(CLOCK_MONOTONIC, &churn_t0);
+	churn_next = (u64)(-1000000.0f * logf(churn_random()) / sim_churn.rate);
+
+	sim_churn.active = 1;
+
+	LOG_CHURN("Churn started: %.0f arrivals/s, %s holding %.0f-%.0f ms\n",
+		sim_churn.rate,
+		churn_hold_to_string(sim_churn.hold),
+		sim_churn.hold_a,
+		sim_churn.hold_b);
+
+	return SUCCESS;
+}
+
+void churn_stop(void)
+{
+	sim_churn.active = 0;
+	churn_nof_deps   = 0;
+}
+
+/******************************************************************************
+ * Churn simulation logic:                                                    *
+ ******************************************************************************/
+
+u32 churn_compute(void)
+{
+	u64 now;
+
+	if(!sim_churn.active) {
+		return SUCCESS;
+	}
+
+	now = churn_us(&churn_t0);
+
+	/* Replay, in order, all the events which happened since the last
+	 * step; the achieved rate does not depend on the loop interval.
+	 */
+	for(;;) {
+		if(churn_nof_deps > 0 &&
+			churn_deps[0].t <= churn_next &&
+			churn_deps[0].t <= now) {
+
+			churn_depart();
+			continue;
+		}
+
+		if(churn_next > now) {
+			break;
+		}
+
+		churn_arrive(churn_next);
+
+		churn_next += (u64)(
+			-1000000.0f * logf(churn_random()) / sim_churn.rate);
+	}
+
+	if(now - churn_stats_t >= CHURN_STATS_INT) {
+		churn_stats(now);
+	}
+
+	return SUCCESS;
+}
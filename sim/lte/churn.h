@@ -0,0 +1,121 @@
+/* Copyright (c) 2017 Kewin Rausch
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Empower Agent simulator UE churn module.
+ *
+ * Generates UE arrivals as a Poisson process with the given rate; each UE
+ * stays attached for a holding time drawn from the selected distribution and
+ * then leaves. IMSIs are taken from a pool and PLMNs in turn from a list, so
+ * that a run can be repeated exactly with the same seed.
+ */
+
+#ifndef __EM_SIM_CHURN_H
+#define __EM_SIM_CHURN_H
+
+#include <emtypes.h>
+
+/* Maximum number of PLMNs in the pool. */
+#define CHURN_PLMN_MAX			8
+
+/* Default first IMSI of the pool. */
+#define CHURN_IMSI_BASE_DEFAULT		1010000000000ULL
+/* Default size of the IMSI pool. */
+#define CHURN_IMSI_NOF_DEFAULT		1000000
+
+/* Default holding time, in ms. */
+#define CHURN_HOLD_DEFAULT		1000.0f
+
+/* Distributions of the holding time. */
+enum churn_holds {
+	/* Exponential with mean hold_a. */
+	CHURN_HOLD_EXP = 0,
+	/* Always hold_a. */
+	CHURN_HOLD_FIXED,
+	/* Uniform between hold_a and hold_b. */
+	CHURN_HOLD_UNIFORM,
+};
+
+/* Describes the churn generator. */
+typedef struct __em_sim_churn {
+	/* Is the generator running? */
+	u32 active;
+
+	/* Arrivals per second. */
+	sp  rate;
+
+	/* Distribution of the holding time. */
+	u32 hold;
+	/* Parameters of the distribution, in ms. */
+	sp  hold_a;
+	sp  hold_b;
+
+	/* First IMSI of the pool. */
+	u64 imsi_base;
+	/* Number of IMSIs in the pool. */
+	u32 imsi_nof;
+
+	/* PLMNs given in turn to the new UEs. */
+	u32 plmn[CHURN_PLMN_MAX];
+	u32 nof_plmn;
+
+	/* Seed of the generator; same seed, same sequence of events. */
+	u32 seed;
+
+	/* UEs which attached. */
+	u64 nof_add;
+	/* UEs which left. */
+	u64 nof_rem;
+	/* Arrivals refused because the cell was full. */
+	u64 nof_block;
+	/* Other failed operations. */
+	u64 nof_fail;
+} em_churn;
+
+/******************************************************************************
+ * Globals used all around the simulator:                                     *
+ ******************************************************************************/
+
+/* Churn generator configuration and counters. */
+extern em_churn sim_churn;
+
+/******************************************************************************
+ * Public accessible procedures:                                              *
+ ******************************************************************************/
+
+/* Translate the name of a holding time distribution in its identifier.
+ * Returns the distribution, or a negative error code if the name is unknown.
+ */
+int churn_hold_from_string(char * name);
+
+/* Returns the name of the given holding time distribution. */
+char * churn_hold_to_string(u32 hold);
+
+/* Starts generating arrivals and departures with the current configuration.
+ * Returns 0 on success, otherwise a negative error code.
+ */
+int churn_start(void);
+
+/* Stops the generator; UEs already attached by it are left in place. */
+void churn_stop(void);
+
+/* Performs the arrivals and departures which are due at this time, and logs
+ * achieved rate and operation latencies once per second.
+ *
+ * Returns 0 on success, otherwise a negative error code.
+ */
+u32 churn_compute(void);
+
+#endif /* __EM_SIM_CHURN_H */
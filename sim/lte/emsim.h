@@ -20,13 +20,20 @@
 #ifndef __EM_SIM_H
 #define __EM_SIM_H
 
+#include "churn.h"
 #include "err.h"
+#include "event.h"
+#include "hash.h"
 #include "iface.h"
 #include "log.h"
+#include "mobility.h"
 #include "neigh.h"
 #include "plmn.h"
+#include "report.h"
 #include "scenario.h"
 #include "stack.h"
+#include "timer.h"
+#include "trace.h"
 #include "ue.h"
 #include "wrap.h"
 #include "x2.h"
@@ -47,9 +54,7 @@ extern u32    sim_loop_int;
 extern char   sim_ctrl_addr[64];
 /* Port used to connect to the controller */
 extern u16    sim_ctrl_port;
-#if 1
-extern int sim_switch;
-#endif
+
 /******************************************************************************
  * Globals utilities:                                                         *
  ******************************************************************************/
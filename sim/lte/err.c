@@ -24,6 +24,18 @@ char * err_to_str(s32 err)
 	switch(err) {
 	case ERR_UNKNOWN:
 		return "Unknown error";
+	case ERR_CHURN_HOLD_UNKNOWN:
+		return "Unknown holding time distribution";
+	case ERR_CHURN_START_CONF:
+		return "Invalid churn configuration";
+	case ERR_EV_TYPE_UNKNOWN:
+		return "Unknown measurement event";
+	case ERR_EV_QUANTITY_UNKNOWN:
+		return "Unknown measurement quantity";
+	case ERR_HASH_INIT_MEM:
+		return "No more memory for indexes";
+	case ERR_HASH_PUT_FULL:
+		return "Index is full";
 	case ERR_LOG_INIT_IO:
 		return "I/O error on Log initialization";
 	/*
@@ -43,10 +55,26 @@ char * err_to_str(s32 err)
 		return "Maximum level of eNB reached";
 	case ERR_NEI_REM_NOT_FOUND:
 		return "eNB not found during removal";
+	case ERR_NEI_ADD_ADDR:
+		return "Invalid eNB address";
+	case ERR_NEI_ADD_MEM:
+		return "No more memory for eNBs";
+	case ERR_NEI_INIT_INDEX:
+		return "Cannot allocate eNB indexes";
+	case ERR_TRC_OPEN_IO:
+		return "Cannot open the trace file";
+	case ERR_TRC_OPEN_MAP:
+		return "Cannot map the trace file";
+	case ERR_TRC_OPEN_EMPTY:
+		return "No records in the trace file";
 	case ERR_UE_ADD_EXISTS:
 		return "UE already exists";
 	case ERR_UE_ADD_FULL:
 		return "Maximum level of UE reached";
+	case ERR_UE_BAND_INVALID:
+		return "Invalid band";
+	case ERR_UE_NGH_MEM:
+		return "No more memory for UE neighbors";
 	case ERR_X2_INIT_SOCKET:
 		return "Cannot create X2 socket";
 	case ERR_X2_INIT_BIND:
@@ -55,6 +83,14 @@ char * err_to_str(s32 err)
 		return "Cell not found during hand-over";
 	case ERR_X2_HO_UE:
 		return "Ue not found during hand-over";
+	case ERR_X2_DISC_SOCKET:
+		return "Cannot set up the discovery socket";
+	case ERR_X2_DISC_JOIN:
+		return "Cannot join the discovery group";
+	case ERR_X2_HO_BUSY:
+		return "Hand-over already in progress";
+	case ERR_X2_INIT_INDEX:
+		return "Cannot allocate hand-over index";
 	case SUCCESS:
 		return "Success";
 	}
@@ -30,6 +30,35 @@
 enum __em_sim_errors {
 	ERR_UNKNOWN = -ERR_MAX_ERRORS,
 
+	/*
+	 * CHURN errors:
+	 */
+
+	/* The name of the holding time distribution is not known. */
+	ERR_CHURN_HOLD_UNKNOWN,
+	/* The generator configuration is not valid. */
+	ERR_CHURN_START_CONF,
+
+	/*
+	 * EVENT errors:
+	 */
+
+	/* The name of the event is not known. */
+	ERR_EV_TYPE_UNKNOWN,
+	/* The name of the quantity is not known. */
+	ERR_EV_QUANTITY_UNKNOWN,
+
+	/*
+	 * HASH errors:
+	 */
+
+	/* Not enough memory to allocate the index. */
+	ERR_HASH_INIT_MEM,
+	/* No more free entries in the index. */
+	ERR_HASH_PUT_FULL,
+	/* The key has not been found during removal. */
+	ERR_HASH_DEL_NOT_FOUND,
+
 	/*
 	 * LOG errors:
 	 */
@@ -58,6 +87,15 @@ enum __em_sim_errors {
 	/* No more memory in RAN Sharing message creation. */
 	ERR_MSG_RRE_MEM,
 
+	/*
+	 * MOBILITY errors:
+	 */
+
+	/* The name of the mobility model is not known. */
+	ERR_MOB_MODEL_UNKNOWN,
+	/* Position given to an UE which does not exist. */
+	ERR_MOB_POS_UE,
+
 	/*
 	 * NEIGH errors:
 	 */
@@ -68,6 +106,12 @@ enum __em_sim_errors {
 	ERR_NEI_ADD_FULL,
 	/* The neighbors has not been found during removal. */
 	ERR_NEI_REM_NOT_FOUND,
+	/* The address of the neighbor is not a valid IPv4 one. */
+	ERR_NEI_ADD_ADDR,
+	/* No memory left to grow the neighbor table. */
+	ERR_NEI_ADD_MEM,
+	/* Memory for the neighbor indexes or table cannot be allocated. */
+	ERR_NEI_INIT_INDEX,
 
 	/*
 	 * PHY errors:
@@ -133,6 +177,17 @@ enum __em_sim_errors {
 	/* No more slots free for new UE schedulers. */
 	ERR_RAN_USCH_FULL,
 
+	/*
+	 * TRACE errors:
+	 */
+
+	/* The trace file cannot be opened. */
+	ERR_TRC_OPEN_IO,
+	/* The trace file cannot be mapped in memory. */
+	ERR_TRC_OPEN_MAP,
+	/* The trace file does not contain any record. */
+	ERR_TRC_OPEN_EMPTY,
+
 	/*
 	 * UE errors:
 	 */
@@ -143,6 +198,18 @@ enum __em_sim_errors {
 	ERR_UE_ADD_FULL,
 	/* UE added to an unknown PCI */
 	ERR_UE_ADD_PCI_UNKNOWN,
+	/* The RNTI is not in the valid range. */
+	ERR_UE_RNTI_INVALID,
+	/* The RNTI is already assigned to another UE. */
+	ERR_UE_RNTI_IN_USE,
+	/* The UE has not been found during removal. */
+	ERR_UE_REM_NOT_FOUND,
+	/* Indexes of the UE could not be initialized. */
+	ERR_UE_INIT_INDEX,
+	/* Band number out of the supported ones. */
+	ERR_UE_BAND_INVALID,
+	/* No memory left for the neighbors heard by the UE. */
+	ERR_UE_NGH_MEM,
 
 	/*
 	 * WRAP errors:
@@ -162,6 +229,16 @@ enum __em_sim_errors {
 	ERR_X2_HO_UE,
 	/* Alive procedure detected yourself as a neighbor. */
 	ERR_X2_ALIVE_ME,
+	/* The ALIVE message could not be sent to a neighbor. */
+	ERR_X2_PRESENT,
+	/* The discovery socket could not be set up. */
+	ERR_X2_DISC_SOCKET,
+	/* The discovery group could not be joined. */
+	ERR_X2_DISC_JOIN,
+	/* The UE is already being handed over. */
+	ERR_X2_HO_BUSY,
+	/* Could not allocate the index of the received hand-overs. */
+	ERR_X2_INIT_INDEX,
 
 	/*
 	 * Finally the succeed code, which is not really an 'error'.
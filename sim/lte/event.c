@@ -0,0 +1,251 @@
+/* Copyright (c) 2017 Kewin Rausch
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Empower Agent simulator measurement events module.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "emsim.h"
+
+/******************************************************************************
+ * Globals used all around the simulator:                                     *
+ ******************************************************************************/
+
+em_ev sim_ev = {
+	.type     = EV_NONE,
+	.quantity = EV_RSRP,
+	.thr1     = 0.0f,
+	.thr2     = 0.0f,
+	.hyst     = 0.0f,
+	.ttt      = 0,
+};
+
+/******************************************************************************
+ * Private procedures for events module only:                                 *
+ ******************************************************************************/
+
+/* Returns the quantity the event looks at, in dBm or dB. */
+static inline sp ev_level(em_phy_rs * rs, u32 quantity)
+{
+	return quantity == EV_RSRQ ?
+		phy_rsrq_from_range(rs->rsrq) : phy_rsrp_from_range(rs->rsrp);
+}
+
+/******************************************************************************
+ * Public accessible procedures:                                              *
+ ******************************************************************************/
+
+int ev_type_from_string(char * name)
+{
+	if(strcmp(name, "none") == 0) {
+		return EV_NONE;
+	}
+
+	if(strcmp(name, "a1") == 0) {
+		return EV_A1;
+	}
+
+	if(strcmp(name, "a2") == 0) {
+		return EV_A2;
+	}
+
+	if(strcmp(name, "a3") == 0) {
+		return EV_A3;
+	}
+
+	if(strcmp(name, "a4") == 0) {
+		return EV_A4;
+	}
+
+	if(strcmp(name, "a5") == 0) {
+		return EV_A5;
+	}
+
+	return ERR_EV_TYPE_UNKNOWN;
+}
+
+char * ev_type_to_string(u32 type)
+{
+	switch(type) {
+	case EV_A1:
+		return "a1";
+	case EV_A2:
+		return "a2";
+	case EV_A3:
+		return "a3";
+	case EV_A4:
+		return "a4";
+	case EV_A5:
+		return "a5";
+	}
+
+	return "none";
+}
+
+int ev_quantity_from_string(char * name)
+{
+	if(strcmp(name, "rsrp") == 0) {
+		return EV_RSRP;
+	}
+
+	if(strcmp(name, "rsrq") == 0) {
+		return EV_RSRQ;
+	}
+
+	return ERR_EV_QUANTITY_UNKNOWN;
+}
+
+char * ev_quantity_to_string(u32 quantity)
+{
+	return quantity == EV_RSRQ ? "rsrq" : "rsrp";
+}
+
+int ev_parse(char * str, char * sep, em_ev * ev)
+{
+	char * curr;
+	char * type = strtok_r(str, sep, &curr);
+	char * qnt  = strtok_r(0, sep, &curr);
+	char * thr1 = strtok_r(0, sep, &curr);
+	char * thr2 = strtok_r(0, sep, &curr);
+	char * hyst = strtok_r(0, sep, &curr);
+	char * ttt  = strtok_r(0, sep, &curr);
+
+	int    t;
+	int    q = EV_RSRP;
+
+	if(!type) {
+		return ERR_EV_TYPE_UNKNOWN;
+	}
+
+	t = ev_type_from_string(type);
+
+	if(t < 0) {
+		return t;
+	}
+
+	if(qnt) {
+		q = ev_quantity_from_string(qnt);
+
+		if(q < 0) {
+			return q;
+		}
+	}
+
+	ev->type     = (u32)t;
+	ev->quantity = (u32)q;
+	ev->thr1     = thr1 ? (sp)atof(thr1) : 0.0f;
+	ev->thr2     = thr2 ? (sp)atof(thr2) : 0.0f;
+	ev->hyst     = hyst ? (sp)atof(hyst) : 0.0f;
+	ev->ttt      = ttt  ? (u32)atoi(ttt) : 0;
+
+	return SUCCESS;
+}
+
+/******************************************************************************
+ * Events simulation logic:                                                   *
+ ******************************************************************************/
+
+int ev_check(int ue, int meas, u64 now)
+{
+	int          k;
+	int          n     = sim_nof_neigh > 0;
+	int          enter = 0;
+	int          leave = 0;
+
+	em_ue_rrcm * m     = &sim_ues[ue].meas[meas];
+	em_ev *      e     = &m->ev;
+	em_ue_ngh *  g;
+	em_phy_rs    lo;
+
+	sp           ms    = ev_level(&m->rs, e->quantity);
+	sp           mn;
+	sp           l;
+
+	/* Strongest neighbor; the ones not heard are at the lowest levels. */
+	lo.rsrp = phy_rsrp_to_range(PHY_RSRP_LOWER);
+	lo.rsrq = phy_rsrq_to_range(PHY_RSRQ_LOWER);
+	mn      = ev_level(&lo, e->quantity);
+
+	for(k = 0; k < sim_ues[ue].nof_ngh; k++) {
+		g = ue_ngh_at(ue, k);
+
+		/* Parked, or on a band the UE does not see. */
+		if(sim_neighs[g->n]->state == NEIGH_STATE_DEAD ||
+			!ue_band_has(ue, sim_neighs[g->n]->band)) {
+
+			continue;
+		}
+
+		l = ev_level(&g->rs, e->quantity);
+
+		if(l > mn) {
+			mn = l;
+		}
+	}
+
+	switch(e->type) {
+	case EV_A1:
+		enter = ms - e->hyst > e->thr1;
+		leave = ms + e->hyst < e->thr1;
+		break;
+	case EV_A2:
+		enter = ms + e->hyst < e->thr1;
+		leave = ms - e->hyst > e->thr1;
+		break;
+	case EV_A3:
+		enter = n && mn - e->hyst > ms + e->thr1;
+		leave = !n || mn + e->hyst < ms + e->thr1;
+		break;
+	case EV_A4:
+		enter = n && mn - e->hyst > e->thr1;
+		leave = !n || mn + e->hyst < e->thr1;
+		break;
+	case EV_A5:
+		enter = n && ms + e->hyst < e->thr1 && mn - e->hyst > e->thr2;
+		leave = !n || ms - e->hyst > e->thr1 || mn + e->hyst < e->thr2;
+		break;
+	default:
+		return 0;
+	}
+
+	if(m->ev_state == EV_STATE_TRIGGERED) {
+		if(leave) {
+			m->ev_state = EV_STATE_IDLE;
+		}
+
+		return 0;
+	}
+
+	if(!enter) {
+		m->ev_state = EV_STATE_IDLE;
+		return 0;
+	}
+
+	if(m->ev_state == EV_STATE_IDLE) {
+		m->ev_state = EV_STATE_PENDING;
+		m->ev_since = now;
+	}
+
+	if(now - m->ev_since < e->ttt) {
+		return 0;
+	}
+
+	m->ev_state = EV_STATE_TRIGGERED;
+
+	return 1;
+}
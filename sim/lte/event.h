@@ -0,0 +1,123 @@
+/* Copyright (c) 2017 Kewin Rausch
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Empower Agent simulator measurement events module.
+ *
+ * Measurements can be reported when one of the 3GPP TS 36.331 events occurs,
+ * rather than at every change of the levels:
+ *
+ *      A1: serving becomes better than threshold.
+ *      A2: serving becomes worse than threshold.
+ *      A3: neighbor becomes offset better than serving.
+ *      A4: neighbor becomes better than threshold.
+ *      A5: serving becomes worse than threshold1 and neighbor becomes
+ *          better than threshold2.
+ *
+ * An event fires, and the measurement is reported, once its entering
+ * condition held for the time-to-trigger; it can fire again only after its
+ * leaving condition is met. Hysteresis applies to both conditions. Events on
+ * neighbors are evaluated on the strongest one.
+ */
+
+#ifndef __EM_SIM_EVENT_H
+#define __EM_SIM_EVENT_H
+
+#include <emtypes.h>
+
+/* Events which trigger a measurement report. */
+enum ev_types {
+	/* No event; every change of the levels is reported. */
+	EV_NONE = 0,
+	EV_A1,
+	EV_A2,
+	EV_A3,
+	EV_A4,
+	EV_A5,
+};
+
+/* Quantity events look at. */
+enum ev_quantities {
+	EV_RSRP = 0,
+	EV_RSRQ,
+};
+
+/* Evaluation state of an event. */
+enum ev_states {
+	/* Entering condition not met. */
+	EV_STATE_IDLE = 0,
+	/* Entering condition met; waiting for the time-to-trigger. */
+	EV_STATE_PENDING,
+	/* Event fired; waiting for the leaving condition. */
+	EV_STATE_TRIGGERED,
+};
+
+/* Configuration of the event of a measurement. */
+typedef struct __em_sim_event {
+	/* Event type. */
+	u32 type;
+	/* Quantity to look at. */
+	u32 quantity;
+
+	/* Threshold (A1, A2, A4), offset (A3) or threshold1 (A5). */
+	sp  thr1;
+	/* Threshold2 (A5). */
+	sp  thr2;
+	/* Hysteresis, in dB. */
+	sp  hyst;
+
+	/* Time-to-trigger, in ms. */
+	u32 ttt;
+} em_ev;
+
+/******************************************************************************
+ * Globals used all around the simulator:                                     *
+ ******************************************************************************/
+
+/* Event given to the new UEs. */
+extern em_ev sim_ev;
+
+/******************************************************************************
+ * Public accessible procedures:                                              *
+ ******************************************************************************/
+
+/* Translate the name of an event ("none", "a1" ... "a5") in its type.
+ * Returns the type, or a negative error code if the name is unknown.
+ */
+int ev_type_from_string(char * name);
+
+/* Returns the name of the given event type. */
+char * ev_type_to_string(u32 type);
+
+/* Translate the name of a quantity ("rsrp", "rsrq") in its identifier.
+ * Returns the quantity, or a negative error code if the name is unknown.
+ */
+int ev_quantity_from_string(char * name);
+
+/* Returns the name of the given quantity. */
+char * ev_quantity_to_string(u32 quantity);
+
+/* Parses an event in the form "type[ quantity thr1 thr2 hyst ttt]", where
+ * fields are separated by any of the characters in 'sep'.
+ * Returns 0 on success, otherwise a negative error code.
+ */
+int ev_parse(char * str, char * sep, em_ev * ev);
+
+/* Evaluates the event of measurement 'meas' of UE 'ue' at time 'now', in ms.
+ * Returns 1 if the event fired and the measurement shall be reported.
+ */
+int ev_check(int ue, int meas, u64 now);
+
+#endif /* __EM_SIM_EVENT_H */
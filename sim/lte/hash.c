@@ -0,0 +1,173 @@
+/* Copyright (c) 2017 Kewin Rausch
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Empower Agent simulator index module.
+ */
+
+#include <stdlib.h>
+
+#include "emsim.h"
+
+/* Mix the bits of the key, so that sequential keys (RNTIs, IMSIs, ids) do not
+ * end up in a single cluster of the table.
+ */
+static inline u32 hash_mix(u64 key)
+{
+	key ^= key >> 33;
+	key *= 0xff51afd7ed558ccdULL;
+	key ^= key >> 33;
+	key *= 0xc4ceb9fe1a85ec53ULL;
+	key ^= key >> 33;
+
+	return (u32)key;
+}
+
+/******************************************************************************
+ * Public accessible procedures:                                              *
+ ******************************************************************************/
+
+int hash_init(em_hash * h, u32 nof)
+{
+	u32 i;
+	u32 s = 16;
+
+	/* Keep the table at least half empty, so probes remain short. */
+	while(s < nof * 2) {
+		s <<= 1;
+	}
+
+	h->ents = malloc(sizeof(em_hash_ent) * s);
+
+	if(!h->ents) {
+		return ERR_HASH_INIT_MEM;
+	}
+
+	h->size = s;
+	h->nof  = 0;
+
+	for(i = 0; i < s; i++) {
+		h->ents[i].val = HASH_INVALID;
+	}
+
+	return SUCCESS;
+}
+
+void hash_release(em_hash * h)
+{
+	free(h->ents);
+
+	h->ents = 0;
+	h->size = 0;
+	h->nof  = 0;
+}
+
+void hash_clear(em_hash * h)
+{
+	u32 i;
+
+	for(i = 0; i < h->size; i++) {
+		h->ents[i].val = HASH_INVALID;
+	}
+
+	h->nof = 0;
+}
+
+s32 hash_get(em_hash * h, u64 key)
+{
+	u32 m = h->size - 1;
+	u32 i = hash_mix(key) & m;
+
+	while(h->ents[i].val != HASH_INVALID) {
+		if(h->ents[i].key == key) {
+			return h->ents[i].val;
+		}
+
+		i = (i + 1) & m;
+	}
+
+	return HASH_INVALID;
+}
+
+int hash_put(em_hash * h, u64 key, s32 val)
+{
+	u32 m = h->size - 1;
+	u32 i = hash_mix(key) & m;
+
+	while(h->ents[i].val != HASH_INVALID) {
+		/* Already there; just update the slot. */
+		if(h->ents[i].key == key) {
+			h->ents[i].val = val;
+			return SUCCESS;
+		}
+
+		i = (i + 1) & m;
+	}
+
+	/* Always leave at least one free entry, or lookups will never end. */
+	if(h->nof + 1 >= h->size) {
+		return ERR_HASH_PUT_FULL;
+	}
+
+	h->ents[i].key = key;
+	h->ents[i].val = val;
+	h->nof++;
+
+	return SUCCESS;
+}
+
+int hash_del(em_hash * h, u64 key)
+{
+	u32 m = h->size - 1;
+	u32 i = hash_mix(key) & m;
+	u32 j;
+	u32 k;
+
+	while(h->ents[i].val != HASH_INVALID) {
+		if(h->ents[i].key == key) {
+			break;
+		}
+
+		i = (i + 1) & m;
+	}
+
+	if(h->ents[i].val == HASH_INVALID) {
+		return ERR_HASH_DEL_NOT_FOUND;
+	}
+
+	/* Backward-shift: move back the following entries of the cluster which
+	 * would not be reachable anymore once 'i' has been freed.
+	 */
+	j = i;
+
+	for(;;) {
+		h->ents[i].val = HASH_INVALID;
+
+		do {
+			j = (j + 1) & m;
+
+			if(h->ents[j].val == HASH_INVALID) {
+				h->nof--;
+				return SUCCESS;
+			}
+
+			k = hash_mix(h->ents[j].key) & m;
+		/* Entry 'j' stays if its home 'k' lies cyclically in (i, j]. */
+		} while(i <= j ? (i < k && k <= j) : (i < k || k <= j));
+
+		h->ents[i] = h->ents[j];
+		i = j;
+	}
+}
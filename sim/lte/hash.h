@@ -0,0 +1,82 @@
+/* Copyright (c) 2017 Kewin Rausch
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Empower Agent simulator index module.
+ *
+ * Open-addressing (linear probing) hash tables which map a 64 bits key to the
+ * index of a slot in one of the simulator tables. Removal uses backward-shift
+ * deletion, so no tombstones accumulate over time.
+ */
+
+#ifndef __EM_SIM_HASH_H
+#define __EM_SIM_HASH_H
+
+#include <emtypes.h>
+
+/* Value returned when a key is not present in the index. */
+#define HASH_INVALID			-1
+
+/* Single entry of the index. */
+typedef struct __em_sim_hash_entry {
+	/* Key of the entry. */
+	u64 key;
+	/* Slot associated with the key; HASH_INVALID if the entry is free. */
+	s32 val;
+} em_hash_ent;
+
+/* Describes an index. */
+typedef struct __em_sim_hash {
+	/* Number of entries; always a power of 2. */
+	u32           size;
+	/* Number of entries in use. */
+	u32           nof;
+	/* Entries of the index. */
+	em_hash_ent * ents;
+} em_hash;
+
+/******************************************************************************
+ * Public accessible procedures:                                              *
+ ******************************************************************************/
+
+/* Allocates an index able to hold at least 'nof' keys while keeping the load
+ * factor at most at 50%.
+ *
+ * Returns 0 on success, otherwise a negative error code.
+ */
+int hash_init(em_hash * h, u32 nof);
+
+/* Releases the memory used by the index. */
+void hash_release(em_hash * h);
+
+/* Removes all the keys from the index. */
+void hash_clear(em_hash * h);
+
+/* Look for a key in the index.
+ * Returns the associated slot, or HASH_INVALID if the key is not there.
+ */
+s32 hash_get(em_hash * h, u64 key);
+
+/* Associates a key with a slot, replacing any previous association.
+ * Returns 0 on success, otherwise a negative error code.
+ */
+int hash_put(em_hash * h, u64 key, s32 val);
+
+/* Removes a key from the index.
+ * Returns 0 on success, otherwise a negative error code.
+ */
+int hash_del(em_hash * h, u64 key);
+
+#endif /* __EM_SIM_HASH_H */
@@ -25,8 +25,6 @@
 #include "../../emsim.h"
 #include "../iface_priv.h"
 
-#define ts_msec(t)	((t.tv_sec * 1000) + (t.tv_nsec / 1000000))
-
 #define IFACE_ENB_ID_MAX	10
 #define IFACE_ENB_IP_MAX	15
 #define IFACE_ENB_PORT_MAX	6
@@ -38,7 +36,6 @@
 u32 iface_enb_ho_mask= 0;
 u32 iface_enb_ho_sel = 0;
 u16 iface_enb_ho_rnti= 0;
-u32 iface_enb_ho_idx = 0;
 
 /*
  * Add eNB stuff.
@@ -69,12 +66,22 @@ u32 iface_enb_uenm_mask = 0;
 s32 iface_enb_sel = 1;
 s32 iface_enb_sel_idx = 0;
 
+/* Rows of the list scrolled out on top. */
+s32 iface_enb_top = 0;
+/* Number of eNBs in the list, counted while drawing it. */
+s32 iface_enb_nof = 0;
+
+/* Rows of the list which fit in the screen. */
+#define IFACE_ENB_ROWS		(iface_row - 12 > 0 ? iface_row - 12 : 1)
+
 /******************************************************************************
  * UE measurements management for neighbor cells.                             *
  ******************************************************************************/
 
 int iface_enb_handle_uenm_input(int key)
 {
+	em_phy_rs rs;
+
 	switch(key) {
 	/*
 	 * These are 'hidden' commands that will be either documented or removed
@@ -85,17 +92,12 @@ int iface_enb_handle_uenm_input(int key)
 			break;
 		}
 
-		sim_neighs[iface_enb_sel_idx].rs[iface_ue_sel_idx].rsrp += 0.1;
-
-		if(sim_neighs[iface_enb_sel_idx].rs[iface_ue_sel_idx].rsrp >
-			PHY_RSRP_HIGHER) {
-
-			sim_neighs[iface_enb_sel_idx].rs[iface_ue_sel_idx].
-				rsrp = PHY_RSRP_HIGHER;
-		}
+		ue_ngh_get(iface_ue_sel_idx, iface_enb_sel_idx, &rs);
+		rs.rsrp = phy_rsrp_step(rs.rsrp, 1);
+		ue_ngh_set(iface_ue_sel_idx, iface_enb_sel_idx, &rs);
 
 		/* This trigger an update for the controller. */
-		sim_ues[iface_ue_sel_idx].meas[0].dirty = 1;
+		ue_meas_dirty(iface_ue_sel_idx, 0);
 
 		break;
 	case 'q':
@@ -103,17 +105,12 @@ int iface_enb_handle_uenm_input(int key)
 			break;
 		}
 
-		sim_neighs[iface_enb_sel_idx].rs[iface_ue_sel_idx].rsrp -= 0.1f;
-
-		if(sim_neighs[iface_enb_sel_idx].rs[iface_ue_sel_idx].rsrp <
-			PHY_RSRP_LOWER) {
-
-			sim_neighs[iface_enb_sel_idx].rs[iface_ue_sel_idx].
-				rsrp = PHY_RSRP_LOWER;
-		}
+		ue_ngh_get(iface_ue_sel_idx, iface_enb_sel_idx, &rs);
+		rs.rsrp = phy_rsrp_step(rs.rsrp, -1);
+		ue_ngh_set(iface_ue_sel_idx, iface_enb_sel_idx, &rs);
 
 		/* This trigger an update for the controller. */
-		sim_ues[iface_ue_sel_idx].meas[0].dirty = 1;
+		ue_meas_dirty(iface_ue_sel_idx, 0);
 
 		break;
 	case 'r':
@@ -121,17 +118,12 @@ int iface_enb_handle_uenm_input(int key)
 			break;
 		}
 
-		sim_neighs[iface_enb_sel_idx].rs[iface_ue_sel_idx].rsrp += 1.0f;
-
-		if(sim_neighs[iface_enb_sel_idx].rs[iface_ue_sel_idx].rsrp >
-			PHY_RSRP_HIGHER) {
-
-			sim_neighs[iface_enb_sel_idx].rs[iface_ue_sel_idx].
-				rsrp = PHY_RSRP_HIGHER;
-		}
+		ue_ngh_get(iface_ue_sel_idx, iface_enb_sel_idx, &rs);
+		rs.rsrp = phy_rsrp_step(rs.rsrp, 5);
+		ue_ngh_set(iface_ue_sel_idx, iface_enb_sel_idx, &rs);
 
 		/* This trigger an update for the controller. */
-		sim_ues[iface_ue_sel_idx].meas[0].dirty = 1;
+		ue_meas_dirty(iface_ue_sel_idx, 0);
 
 		break;
 	case 'e':
@@ -139,17 +131,12 @@ int iface_enb_handle_uenm_input(int key)
 			break;
 		}
 
-		sim_neighs[iface_enb_sel_idx].rs[iface_ue_sel_idx].rsrp -= 1.0f;
-
-		if(sim_neighs[iface_enb_sel_idx].rs[iface_ue_sel_idx].rsrp <
-			PHY_RSRP_LOWER) {
-
-			sim_neighs[iface_enb_sel_idx].rs[iface_ue_sel_idx].
-				rsrp = PHY_RSRP_LOWER;
-		}
+		ue_ngh_get(iface_ue_sel_idx, iface_enb_sel_idx, &rs);
+		rs.rsrp = phy_rsrp_step(rs.rsrp, -5);
+		ue_ngh_set(iface_ue_sel_idx, iface_enb_sel_idx, &rs);
 
 		/* This trigger an update for the controller. */
-		sim_ues[iface_ue_sel_idx].meas[0].dirty = 1;
+		ue_meas_dirty(iface_ue_sel_idx, 0);
 
 		break;
 	case 's':
@@ -157,17 +144,12 @@ int iface_enb_handle_uenm_input(int key)
 			break;
 		}
 
-		sim_neighs[iface_enb_sel_idx].rs[iface_ue_sel_idx].rsrq += 0.1;
-
-		if(sim_neighs[iface_enb_sel_idx].rs[iface_ue_sel_idx].rsrq >
-			PHY_RSRQ_HIGHER) {
-
-			sim_neighs[iface_enb_sel_idx].rs[iface_ue_sel_idx].
-				rsrq = PHY_RSRQ_HIGHER;
-		}
+		ue_ngh_get(iface_ue_sel_idx, iface_enb_sel_idx, &rs);
+		rs.rsrq = phy_rsrq_step(rs.rsrq, 1);
+		ue_ngh_set(iface_ue_sel_idx, iface_enb_sel_idx, &rs);
 
 		/* This trigger an update for the controller. */
-		sim_ues[iface_ue_sel_idx].meas[0].dirty = 1;
+		ue_meas_dirty(iface_ue_sel_idx, 0);
 
 		break;
 	case 'a':
@@ -175,17 +157,12 @@ int iface_enb_handle_uenm_input(int key)
 			break;
 		}
 
-		sim_neighs[iface_enb_sel_idx].rs[iface_ue_sel_idx].rsrq -= 0.1f;
-
-		if(sim_neighs[iface_enb_sel_idx].rs[iface_ue_sel_idx].rsrq <
-			PHY_RSRQ_LOWER) {
-
-			sim_neighs[iface_enb_sel_idx].rs[iface_ue_sel_idx].
-				rsrq = PHY_RSRQ_LOWER;
-		}
+		ue_ngh_get(iface_ue_sel_idx, iface_enb_sel_idx, &rs);
+		rs.rsrq = phy_rsrq_step(rs.rsrq, -1);
+		ue_ngh_set(iface_ue_sel_idx, iface_enb_sel_idx, &rs);
 
 		/* This trigger an update for the controller. */
-		sim_ues[iface_ue_sel_idx].meas[0].dirty = 1;
+		ue_meas_dirty(iface_ue_sel_idx, 0);
 
 		break;
 	case 'f':
@@ -193,17 +170,12 @@ int iface_enb_handle_uenm_input(int key)
 			break;
 		}
 
-		sim_neighs[iface_enb_sel_idx].rs[iface_ue_sel_idx].rsrq += 1.0f;
-
-		if(sim_neighs[iface_enb_sel_idx].rs[iface_ue_sel_idx].rsrq >
-			PHY_RSRQ_HIGHER) {
-
-			sim_neighs[iface_enb_sel_idx].rs[iface_ue_sel_idx].
-				rsrq = PHY_RSRQ_HIGHER;
-		}
+		ue_ngh_get(iface_ue_sel_idx, iface_enb_sel_idx, &rs);
+		rs.rsrq = phy_rsrq_step(rs.rsrq, 2);
+		ue_ngh_set(iface_ue_sel_idx, iface_enb_sel_idx, &rs);
 
 		/* This trigger an update for the controller. */
-		sim_ues[iface_ue_sel_idx].meas[0].dirty = 1;
+		ue_meas_dirty(iface_ue_sel_idx, 0);
 
 		break;
 	case 'd':
@@ -211,17 +183,12 @@ int iface_enb_handle_uenm_input(int key)
 			break;
 		}
 
-		sim_neighs[iface_enb_sel_idx].rs[iface_ue_sel_idx].rsrq -= 1.0f;
-
-		if(sim_neighs[iface_enb_sel_idx].rs[iface_ue_sel_idx].rsrq <
-			PHY_RSRQ_LOWER) {
-
-			sim_neighs[iface_enb_sel_idx].rs[iface_ue_sel_idx].
-				rsrq = PHY_RSRQ_LOWER;
-		}
+		ue_ngh_get(iface_ue_sel_idx, iface_enb_sel_idx, &rs);
+		rs.rsrq = phy_rsrq_step(rs.rsrq, -2);
+		ue_ngh_set(iface_ue_sel_idx, iface_enb_sel_idx, &rs);
 
 		/* This trigger an update for the controller. */
-		sim_ues[iface_ue_sel_idx].meas[0].dirty = 1;
+		ue_meas_dirty(iface_ue_sel_idx, 0);
 
 		break;
 	/* This is the ESCape key; remove this mask. */
@@ -237,9 +204,10 @@ int iface_enb_draw_uenm()
 {
 	int i;
 	float j;
+	float p;
+	float q;
 
-	float p = sim_neighs[iface_enb_sel_idx].rs[iface_ue_sel_idx].rsrp;
-	float q = sim_neighs[iface_enb_sel_idx].rs[iface_ue_sel_idx].rsrq;
+	em_phy_rs rs;
 
 	char ti[] = "Measurements for UE ";
 	char in[] = "Use {q,w,e,r} for RSRP, {a,s,d,f} for RSRQ";
@@ -250,6 +218,11 @@ int iface_enb_draw_uenm()
 		iface_to_ue_screen();
 	}
 
+	ue_ngh_get(iface_ue_sel_idx, iface_enb_sel_idx, &rs);
+
+	p = phy_rsrp_from_range(rs.rsrp);
+	q = phy_rsrq_from_range(rs.rsrq);
+
 	attron(COLOR_PAIR(IFACE_CPAIR_HIGHLIGHT));
 
 	for(i = 0; i < 7; i++) {
@@ -367,6 +340,11 @@ int iface_enb_draw_uenm()
 
 int iface_enb_handover_input(int key)
 {
+	static u16 rntis[UE_MAX];
+
+	int i;
+	u32 n;
+
 	switch(key) {
 	case KEY_UP:
 		iface_enb_ho_sel--;
@@ -386,16 +364,25 @@ int iface_enb_handover_input(int key)
 		break;
 	/* This is the ENTER key */
 	case 10:
-		/* Perform the hand-over. */
+		/* Perform the hand-over; the UE leaves once acknowledged. */
 		iface_err = x2_hand_over(
 			iface_enb_ho_rnti,
-			sim_neighs[iface_enb_ho_idx].id);
+			sim_neighs[iface_enb_sel_idx]->id,
+			0);
 
-		if(!iface_err) {
-			/* Remove the UE from here. */
-			ue_rem(iface_enb_ho_rnti, 0);
+		iface_enb_ho_mask = 0;
+		break;
+	/* Hand all the UEs over together. */
+	case 'a':
+		for(i = 0, n = 0; i < UE_MAX; i++) {
+			if(sim_ues[i].rnti != UE_RNTI_INVALID) {
+				rntis[n++] = sim_ues[i].rnti;
+			}
 		}
 
+		x2_hand_over_group(
+			rntis, n, sim_neighs[iface_enb_sel_idx]->id, 0);
+
 		iface_enb_ho_mask = 0;
 		break;
 	/* This is the ESCape key; remove this mask. */
@@ -437,7 +424,6 @@ int iface_enb_draw_ho()
 		move(u + 2 + i, (iface_col / 2) - (15 / 2));
 
 		if(iface_enb_ho_sel == s) {
-			iface_enb_ho_idx = s;
 			iface_enb_ho_rnti= sim_ues[i].rnti;
 
 			attroff(COLOR_PAIR(IFACE_CPAIR_HIGHLIGHT));
@@ -450,8 +436,8 @@ int iface_enb_draw_ho()
 		s++;
 	}
 
-	move((iface_row / 2) + 2, iface_col - 16 - 24);
-	printw("Press ENTER to hand over");
+	move((iface_row / 2) + 2, iface_col - 16 - 36);
+	printw("ENTER to hand over, 'a' to move all");
 
 	attroff(COLOR_PAIR(IFACE_CPAIR_HIGHLIGHT));
 
@@ -690,17 +676,32 @@ int iface_enb_handle_input(int key)
 		break;
 	/* Move down between eNBs. */
 	case KEY_DOWN:
-		if(iface_enb_sel < sim_nof_neigh) {
+		if(iface_enb_sel < iface_enb_nof) {
 			iface_enb_sel++;
 		}
 		break;
+	/* Move a page up or down. */
+	case KEY_PPAGE:
+		iface_enb_sel -= IFACE_ENB_ROWS;
+
+		if(iface_enb_sel < 1) {
+			iface_enb_sel = 1;
+		}
+		break;
+	case KEY_NPAGE:
+		iface_enb_sel += IFACE_ENB_ROWS;
+
+		if(iface_enb_sel > iface_enb_nof) {
+			iface_enb_sel = iface_enb_nof > 0 ? iface_enb_nof : 1;
+		}
+		break;
 	/* Add a new eNB. */
 	case 'a':
 		iface_enb_add_mask = 1;
 		break;
 	/* Remove the selected eNB. */
 	case 'r':
-		neigh_rem(sim_neighs[iface_enb_sel_idx].id);
+		neigh_rem(sim_neighs[iface_enb_sel_idx]->id);
 
 		if(iface_enb_sel > 1) {
 			iface_enb_sel--;
@@ -770,30 +771,52 @@ int iface_enb_draw()
 	char tmp[64] = {0};
 	char th[] = "List of known cells in this eNB";
 
-	struct timespec now;
-	clock_gettime(CLOCK_REALTIME, &now);
-
 	iface_enb_draw_topbar();
 
 	move(5, (iface_col / 2) - (sizeof(th) / 2));
 	printw("%s", th);
 
+	/* Outcome of the hand-overs started here. */
+	move(6, 8);
+	printw("Hand-overs: %"PRIu64" done, %"PRIu64" failed, "
+		"%"PRIu64" resent; latency %"PRIu64"/%"PRIu64" ms avg/max",
+		sim_x2_ho_done,
+		sim_x2_ho_fail,
+		sim_x2_ho_retx,
+		sim_x2_ho_done ? sim_x2_ho_lat / sim_x2_ho_done : 0,
+		sim_x2_ho_lat_max);
+
 	/* Print the table header. */
 	move(7, 8);
 	printw( "eNB id     "      /* 11 */
 		"PCI        "      /* 11 */
 		"IPv4            " /* 16 */
-		"Status  ");
+		"Status  "         /* 8 */
+		"HB tx/rx      "   /* 14 */
+		"UEs");
 
 	move(8, 8);
 	for(j = 0; j < iface_col - 16; j++) {
 		printw("-");
 	}
 
-	/* Draw a list of active UEs! */
-	for(i = 0; i < NEIGH_MAX; i++) {
+	/* Scroll so that the selected element is in sight. */
+	if(iface_enb_sel <= iface_enb_top) {
+		iface_enb_top = iface_enb_sel - 1;
+	} else if(iface_enb_sel > iface_enb_top + IFACE_ENB_ROWS) {
+		iface_enb_top = iface_enb_sel - IFACE_ENB_ROWS;
+	}
+
+	/* Draw a list of known eNBs! */
+	for(i = 0; i < sim_neigh_cap; i++) {
 		/* Skip empty elements. */
-		if(sim_neighs[i].id == 0) {
+		if(sim_neighs[i]->id == 0) {
+			continue;
+		}
+
+		/* Out of the page; still counted. */
+		if(s <= iface_enb_top || s > iface_enb_top + IFACE_ENB_ROWS) {
+			s++;
 			continue;
 		}
 
@@ -802,29 +825,35 @@ int iface_enb_draw()
 			iface_enb_sel_idx = i;
 			attron(COLOR_PAIR(IFACE_CPAIR_HIGHLIGHT));
 
-			move(9 + s, 8);
+			move(9 + s - iface_enb_top, 8);
 			for(j = 0; j < iface_col - 16; j++) {
 				printw(" ");
 			}
 		}
 
-		move(9 + s, 8);
-		sprintf(tmp, "%d", sim_neighs[i].id);
+		move(9 + s - iface_enb_top, 8);
+		sprintf(tmp, "%d", sim_neighs[i]->id);
 		printw("%-11s", tmp);
 
-		sprintf(tmp, "%d", sim_neighs[i].pci);
+		sprintf(tmp, "%d", sim_neighs[i]->pci);
 		printw("%-11s", tmp);
 
-		printw("%-16s", sim_neighs[i].ipv4);
+		printw("%-16s", sim_neighs[i]->ipv4);
 
-		if(ts_msec(now) - ts_msec(sim_neighs[i].last_seen) >= 2500) {
+		if(sim_neighs[i]->state != NEIGH_STATE_ALIVE) {
 			if(iface_enb_sel == s) {
 				attron(COLOR_PAIR(IFACE_CPAIR_ERROR_H));
 			} else {
 				attron(COLOR_PAIR(IFACE_CPAIR_ERROR));
 			}
 
-			printw("Offline");
+			if(sim_neighs[i]->state == NEIGH_STATE_SUSPECT) {
+				printw("Suspect");
+			} else if(sim_neighs[i]->state == NEIGH_STATE_DEAD) {
+				printw("Dead");
+			} else {
+				printw("Offline");
+			}
 
 			if(iface_enb_sel == s) {
 				attroff(COLOR_PAIR(IFACE_CPAIR_ERROR_H));
@@ -849,6 +878,15 @@ int iface_enb_draw()
 			}
 		}
 
+		move(9 + s - iface_enb_top, 54);
+		sprintf(tmp, "%"PRIu64"/%"PRIu64"",
+			sim_neighs[i]->hb_tx,
+			sim_neighs[i]->hb_rx);
+		printw("%-14s", tmp);
+
+		sprintf(tmp, "%u", sim_neighs[i]->load);
+		printw("%s", tmp);
+
 		if(iface_enb_sel == s) {
 			attroff(COLOR_PAIR(IFACE_CPAIR_HIGHLIGHT));
 		}
@@ -856,6 +894,18 @@ int iface_enb_draw()
 		s++;
 	}
 
+	iface_enb_nof = s - 1;
+
+	/* Tell where we are when the list does not fit. */
+	if(iface_enb_nof > IFACE_ENB_ROWS) {
+		move(10 + IFACE_ENB_ROWS, 8);
+		printw("eNBs %d-%d of %d, PgUp/PgDn to scroll",
+			iface_enb_top + 1,
+			iface_enb_top + IFACE_ENB_ROWS < iface_enb_nof ?
+				iface_enb_top + IFACE_ENB_ROWS : iface_enb_nof,
+			iface_enb_nof);
+	}
+
 	if(iface_enb_add_mask) {
 		iface_enb_draw_add();
 	} else if(iface_enb_ho_mask) {
@@ -45,6 +45,10 @@ char iface_ue_add_imsi[IMSI_MAX + 1] = {0};
 s32 iface_ue_add_plmn_idx = 0;
 char iface_ue_add_plmn[PLMN_MAX + 1] = {0};
 
+#define BANDS_MAX 19
+s32 iface_ue_add_bands_idx = 0;
+char iface_ue_add_bands[BANDS_MAX + 1] = {0};
+
 /******************************************************************************
  * Detailed UE add mask.                                                      *
  ******************************************************************************/
@@ -53,6 +57,8 @@ int iface_ue_handle_add_input(int key)
 {
 	s32 e;
 	u32 p;
+	u64 b[UE_BAND_WORDS];
+	int i;
 
 	switch(key) {
 	case KEY_LEFT:
@@ -66,8 +72,8 @@ int iface_ue_handle_add_input(int key)
 	case KEY_RIGHT:
 		iface_ue_add_sel++;
 
-		if(iface_ue_add_sel > 2) {
-			iface_ue_add_sel = 2;
+		if(iface_ue_add_sel > 3) {
+			iface_ue_add_sel = 3;
 		}
 
 		break;
@@ -94,15 +100,27 @@ int iface_ue_handle_add_input(int key)
 		if(e < 0) {
 			iface_err = e;
 		}
+		/* Optional bands supported in addition to the cell one. */
+		else if(iface_ue_add_bands[0] != 0) {
+			if(ue_bands_parse(iface_ue_add_bands, ",", b) < 0) {
+				iface_err = ERR_UE_BAND_INVALID;
+			} else {
+				for(i = 0; i < UE_BAND_WORDS; i++) {
+					sim_ues[e].bands[i] |= b[i];
+				}
+			}
+		}
 
 		/* Reset all... */
 		memset(iface_ue_add_rnti, 0, sizeof(char) * RNTI_MAX + 1);
 		memset(iface_ue_add_plmn, 0, sizeof(char) * PLMN_MAX + 1);
 		memset(iface_ue_add_imsi, 0, sizeof(char) * IMSI_MAX + 1);
+		memset(iface_ue_add_bands, 0, sizeof(char) * BANDS_MAX + 1);
 
 		iface_ue_add_rnti_idx= 0;
 		iface_ue_add_plmn_idx= 0;
 		iface_ue_add_imsi_idx= 0;
+		iface_ue_add_bands_idx=0;
 
 		iface_ue_add_sel     = 0;
 		iface_ue_add_mask    = 0;
@@ -114,8 +132,17 @@ int iface_ue_handle_add_input(int key)
 		break;
 	}
 
+	/* Bands are separated by commas. */
+	if(iface_ue_add_sel == 3 && ((key >= 48 && key <= 57) || key == ',')) {
+		if(iface_ue_add_bands_idx >= BANDS_MAX) {
+			iface_ue_add_bands_idx = BANDS_MAX - 1;
+		}
+
+		iface_ue_add_bands[iface_ue_add_bands_idx] = key;
+		iface_ue_add_bands_idx++;
+	}
 	/* Values between 0 and 9 are being pressed on the screen. */
-	if(key >= 48 && key <= 57) {
+	else if(key >= 48 && key <= 57) {
 		if(iface_ue_add_sel == 0) {
 			if(iface_ue_add_rnti_idx >= RNTI_MAX) {
 				iface_ue_add_rnti_idx = RNTI_MAX - 1;
@@ -158,6 +185,14 @@ int iface_ue_handle_add_input(int key)
 			}
 
 			iface_ue_add_imsi[iface_ue_add_imsi_idx] = 0;
+		} else if(iface_ue_add_sel == 3) {
+			iface_ue_add_bands_idx--;
+
+			if(iface_ue_add_bands_idx < 0) {
+				iface_ue_add_bands_idx = 0;
+			}
+
+			iface_ue_add_bands[iface_ue_add_bands_idx] = 0;
 		} else {
 			iface_ue_add_plmn_idx--;
 
@@ -227,6 +262,17 @@ int iface_ue_draw_add()
 		attron(COLOR_PAIR(IFACE_CPAIR_HIGHLIGHT));
 	}
 
+	if(iface_ue_add_sel == 3) {
+		attroff(COLOR_PAIR(IFACE_CPAIR_HIGHLIGHT));
+	}
+
+	move((iface_row / 2) + 1, 24);
+	printw("Bands: %-18s", iface_ue_add_bands);
+
+	if(iface_ue_add_sel == 3) {
+		attron(COLOR_PAIR(IFACE_CPAIR_HIGHLIGHT));
+	}
+
 	move((iface_row / 2) + 2, iface_col - 16 - 21);
 	printw("Press ENTER to create");
 
@@ -277,62 +323,38 @@ int iface_ue_handle_input(int key)
 		break;
 	/* Increase the RSRP of the selected UE. */
 	case 'i':
-		sim_ues[iface_ue_sel_idx].meas[0].rs.rsrp += 0.1f;
-
-		if(sim_ues[iface_ue_sel_idx].meas[0].rs.rsrp >
-			PHY_RSRP_HIGHER) {
-
-			sim_ues[iface_ue_sel_idx].meas[0].rs.rsrp =
-				PHY_RSRP_HIGHER;
-		}
+		sim_ues[iface_ue_sel_idx].meas[0].rs.rsrp = phy_rsrp_step(
+			sim_ues[iface_ue_sel_idx].meas[0].rs.rsrp, 1);
 
 		/* Update also the measurement profile for this cell. */
-		sim_ues[iface_ue_sel_idx].meas[0].dirty = 1;
+		ue_meas_dirty(iface_ue_sel_idx, 0);
 
 		break;
 	/* Decrease the RSRP of the selected UE. */
 	case 'k':
-		sim_ues[iface_ue_sel_idx].meas[0].rs.rsrp -= 0.1f;
-
-		if(sim_ues[iface_ue_sel_idx].meas[0].rs.rsrp <
-			PHY_RSRP_LOWER) {
-
-			sim_ues[iface_ue_sel_idx].meas[0].rs.rsrp =
-				PHY_RSRP_LOWER;
-		}
+		sim_ues[iface_ue_sel_idx].meas[0].rs.rsrp = phy_rsrp_step(
+			sim_ues[iface_ue_sel_idx].meas[0].rs.rsrp, -1);
 
 		/* Update also the measurement profile for this cell. */
-		sim_ues[iface_ue_sel_idx].meas[0].dirty = 1;
+		ue_meas_dirty(iface_ue_sel_idx, 0);
 
 		break;
 	/* Increase the RSRQ of the selected UE. */
 	case 'o':
-		sim_ues[iface_ue_sel_idx].meas[0].rs.rsrq += 0.1f;
-
-		if(sim_ues[iface_ue_sel_idx].meas[0].rs.rsrq >
-			PHY_RSRQ_HIGHER) {
-
-			sim_ues[iface_ue_sel_idx].meas[0].rs.rsrq =
-				PHY_RSRQ_HIGHER;
-		}
+		sim_ues[iface_ue_sel_idx].meas[0].rs.rsrq = phy_rsrq_step(
+			sim_ues[iface_ue_sel_idx].meas[0].rs.rsrq, 1);
 
 		/* Update also the measurement profile for this cell. */
-		sim_ues[iface_ue_sel_idx].meas[0].dirty = 1;
+		ue_meas_dirty(iface_ue_sel_idx, 0);
 
 		break;
 	/* Decrease the RSRQ of the selected UE. */
 	case 'l':
-		sim_ues[iface_ue_sel_idx].meas[0].rs.rsrq -= 0.1f;
-
-		if(sim_ues[iface_ue_sel_idx].meas[0].rs.rsrq <
-			PHY_RSRQ_LOWER) {
-
-			sim_ues[iface_ue_sel_idx].meas[0].rs.rsrq =
-					PHY_RSRQ_LOWER;
-		}
+		sim_ues[iface_ue_sel_idx].meas[0].rs.rsrq = phy_rsrq_step(
+			sim_ues[iface_ue_sel_idx].meas[0].rs.rsrq, -1);
 
 		/* Update also the measurement profile for this cell. */
-		sim_ues[iface_ue_sel_idx].meas[0].dirty = 1;
+		ue_meas_dirty(iface_ue_sel_idx, 0);
 
 		break;
 	}
@@ -381,6 +403,9 @@ int iface_ue_draw()
 	int j;
 	int s = 1;
 
+	float p;
+	float q;
+
 	char tmp[64] = {0};
 	char th[] = "List of active UE in this eNB";
 
@@ -430,13 +455,16 @@ int iface_ue_draw()
 		sprintf(tmp, "%"PRIu64"", sim_ues[i].imsi);
 		printw("%-16s", tmp);
 
-		if(sim_ues[i].meas[0].rs.rsrp < UE_RSRP_ERR_LIMIT) {
+		p = phy_rsrp_from_range(sim_ues[i].meas[0].rs.rsrp);
+		q = phy_rsrq_from_range(sim_ues[i].meas[0].rs.rsrq);
+
+		if(p < UE_RSRP_ERR_LIMIT) {
 			if(iface_ue_sel == s) {
 				attron(COLOR_PAIR(IFACE_CPAIR_ERROR_H));
 			} else {
 				attron(COLOR_PAIR(IFACE_CPAIR_ERROR));
 			}
-		} else if (sim_ues[i].meas[0].rs.rsrp < UE_RSRP_WARN_LIMIT) {
+		} else if (p < UE_RSRP_WARN_LIMIT) {
 			if(iface_ue_sel == s) {
 				attron(COLOR_PAIR(IFACE_CPAIR_WARNING_H));
 			} else {
@@ -450,16 +478,16 @@ int iface_ue_draw()
 			}
 		}
 
-		sprintf(tmp, "%.2f", sim_ues[i].meas[0].rs.rsrp);
+		sprintf(tmp, "%.2f", p);
 		printw("%-10s", tmp);
 
-		if(sim_ues[i].meas[0].rs.rsrq < UE_RSRQ_ERR_LIMIT) {
+		if(q < UE_RSRQ_ERR_LIMIT) {
 			if(iface_ue_sel == s) {
 				attron(COLOR_PAIR(IFACE_CPAIR_ERROR_H));
 			} else {
 				attron(COLOR_PAIR(IFACE_CPAIR_ERROR));
 			}
-		} else if (sim_ues[i].meas[0].rs.rsrq < UE_RSRQ_WARN_LIMIT) {
+		} else if (q < UE_RSRQ_WARN_LIMIT) {
 			if(iface_ue_sel == s) {
 				attron(COLOR_PAIR(IFACE_CPAIR_WARNING_H));
 			} else {
@@ -473,16 +501,16 @@ int iface_ue_draw()
 			}
 		}
 
-		sprintf(tmp, "%.2f", sim_ues[i].meas[0].rs.rsrq);
+		sprintf(tmp, "%.2f", q);
 		printw("%-10s", tmp);
 
-		if(sim_ues[i].meas[0].rs.rsrq < UE_RSRQ_ERR_LIMIT) {
+		if(q < UE_RSRQ_ERR_LIMIT) {
 			if(iface_ue_sel == s) {
 				attroff(COLOR_PAIR(IFACE_CPAIR_ERROR_H));
 			} else {
 				attroff(COLOR_PAIR(IFACE_CPAIR_ERROR));
 			}
-		} else if (sim_ues[i].meas[0].rs.rsrq < UE_RSRQ_WARN_LIMIT) {
+		} else if (q < UE_RSRQ_WARN_LIMIT) {
 			if(iface_ue_sel == s) {
 				attroff(COLOR_PAIR(IFACE_CPAIR_WARNING_H));
 			} else {
@@ -17,6 +17,7 @@
  * Empower Agent simulator main application.
  */
 
+#include <inttypes.h>
 #include <signal.h>
 #include <stdio.h>
 #include <stdlib.h>
@@ -77,10 +78,47 @@ void help(void)
 "    Connect with EmPOWER controller using custom port.\n"
 "--x2p <num>\n"
 "    Use the specified port for X2 interface connection\n"
+"--discovery <group[:port]>\n"
+"    Discover neighbors on a multicast or broadcast group (port 9998)\n"
+"--x2_hb <ms>\n"
+"    Interval between two X2 heartbeats to the same neighbor\n"
+"--neigh_timeout <suspect_ms[:dead_ms]>\n"
+"    Silence after which a neighbor is suspect, then dead; 0 never gives up\n"
 "--scenario <path>\n"
 "    Load a scenario (known UE and neighbors) at startup\n"
+"--event <type[:quantity:thr1:thr2:hyst:ttt_ms]>\n"
+"    Report UE measurements on events a1-a5 on rsrp or rsrq rather than on\n"
+"    every change; thr1 is the offset for a3\n"
 "--hl\n"
-"    Headless, run without UI\n");
+"    Headless, run without UI\n"
+"--mobility <model[:width:height[:min_speed:max_speed]]>\n"
+"    Move UEs with a model (rwp, linear, manhattan) in an area, in meters\n"
+"--shadowing <sd_dB[:corr_ms]>\n"
+"    Log-normal shadowing of the received powers, correlated in time\n"
+"--meas_noise <sd_dB>\n"
+"    Gaussian noise on the UE measurements\n"
+"--l3_filter <k>\n"
+"    L3 filterCoefficient (0-19) applied to the UE measurements\n"
+"--pos <x:y>\n"
+"    Position of this eNB cells in the mobility area, in meters\n"
+"--meas_min <dBm>\n"
+"    Report only the neighbors received above this RSRP\n"
+"--ue_bands <band[,band...]>\n"
+"    Bands supported by the UEs, in addition to the one of their cell\n"
+"--rep_hold <ms>\n"
+"    Hold periodic reports up to ms before sending them in a batch\n"
+"--ue_rep_int <ms>\n"
+"    Report the UE list at most once every ms; closer changes are merged\n"
+"--rnti_rand\n"
+"    Assign RNTIs in random order rather than sequentially\n"
+"--churn <rate[:hold_ms[:dist[:max_hold_ms]]]>\n"
+"    Attach UEs at rate per second, each one leaving after an holding time\n"
+"    distributed as exp (mean), fixed or uniform (hold_ms to max_hold_ms)\n"
+"--churn_pool <imsi_base:nof_imsi[:plmn,plmn,...]>\n"
+"    IMSIs and PLMNs given to the UEs attached by --churn\n"
+"--trace <path[:timeout_ms]>\n"
+"    Replay UE positions from a CSV or binary trace; UEs missing from the\n"
+"    trace for timeout_ms (default 5000) leave the cell\n");
 }
 
 void parse_cell(char * args)
@@ -114,6 +152,236 @@ void parse_cell(char * args)
 	}
 }
 
+void parse_shadowing(char * args)
+{
+	char * sd = strtok(args, ":");
+	char * tc = strtok(0, ":");
+
+	if(!sd) {
+		LOG_MAIN("Shadowing miss the standard deviation!\n");
+		exit(0);
+	}
+
+	sim_mob.shadow_sd = (sp)atof(sd);
+
+	if(tc) {
+		sim_mob.shadow_tc = (sp)atof(tc);
+	}
+
+	LOG_MAIN("Shadowing of %.1f dB, correlated over %.0f ms\n",
+		sim_mob.shadow_sd,
+		sim_mob.shadow_tc);
+}
+
+void parse_discovery(char * args)
+{
+	char * g = strtok(args, ":");
+	char * p = strtok(0, ":");
+
+	if(!g || inet_pton(AF_INET, g, &sim_x2_disc.sin_addr) != 1) {
+		LOG_MAIN("Invalid discovery group!\n");
+		exit(0);
+	}
+
+	sim_x2_disc.sin_family = AF_INET;
+	sim_x2_disc.sin_port   = htons(p ? (u16)atoi(p) : X2_DISC_PORT);
+
+	LOG_MAIN("Neighbors discovered on %s:%u\n",
+		g,
+		ntohs(sim_x2_disc.sin_port));
+}
+
+void parse_x2_hb(char * args)
+{
+	sim_x2_hb = (u32)atoi(args);
+
+	if(!sim_x2_hb) {
+		LOG_MAIN("Invalid X2 heartbeat interval!\n");
+		exit(0);
+	}
+
+	if(sim_neigh_suspect && sim_neigh_suspect <= sim_x2_hb) {
+		LOG_MAIN("Neighbors will turn suspect between heartbeats!\n");
+	}
+
+	LOG_MAIN("X2 heartbeats every %u ms\n", sim_x2_hb);
+}
+
+void parse_neigh_timeout(char * args)
+{
+	char * s = strtok(args, ":");
+	char * d = strtok(0, ":");
+
+	if(!s) {
+		LOG_MAIN("Neighbor timeout miss the suspect time!\n");
+		exit(0);
+	}
+
+	sim_neigh_suspect = (u32)atoi(s);
+
+	if(d) {
+		sim_neigh_dead = (u32)atoi(d);
+	}
+
+	if(sim_neigh_dead < sim_neigh_suspect) {
+		sim_neigh_dead = sim_neigh_suspect;
+	}
+
+	LOG_MAIN("Neighbors suspect after %u ms, dead after %u ms\n",
+		sim_neigh_suspect,
+		sim_neigh_dead);
+}
+
+void parse_mobility(char * args)
+{
+	char * model = strtok(args, ":");
+	char * w     = strtok(0, ":");
+	char * h     = strtok(0, ":");
+	char * vmin  = strtok(0, ":");
+	char * vmax  = strtok(0, ":");
+
+	int    m;
+
+	if(!model) {
+		LOG_MAIN("Mobility must be in the form "
+			"model[:width:height[:min_speed:max_speed]]\n");
+		return;
+	}
+
+	m = mob_model_from_string(model);
+
+	if(m < 0) {
+		LOG_MAIN("Mobility model %s not known!\n", model);
+		exit(0);
+	}
+
+	sim_mob.model = (u32)m;
+
+	if(w && h) {
+		sim_mob.area_w = (sp)atof(w);
+		sim_mob.area_h = (sp)atof(h);
+	}
+
+	if(vmin && vmax) {
+		sim_mob.speed_min = (sp)atof(vmin);
+		sim_mob.speed_max = (sp)atof(vmax);
+	}
+
+	LOG_MAIN("Mobility %s in %.0fx%.0f m, speed %.1f-%.1f m/s\n",
+		mob_model_to_string(sim_mob.model),
+		sim_mob.area_w,
+		sim_mob.area_h,
+		sim_mob.speed_min,
+		sim_mob.speed_max);
+}
+
+void parse_pos(char * args)
+{
+	char * x = strtok(args, ":");
+	char * y = strtok(0, ":");
+
+	if(!x || !y) {
+		LOG_MAIN("Position must be in the form x:y\n");
+		return;
+	}
+
+	sim_mob.x = (sp)atof(x);
+	sim_mob.y = (sp)atof(y);
+
+	LOG_MAIN("eNB located at %.1f, %.1f\n", sim_mob.x, sim_mob.y);
+}
+
+void parse_churn(char * args)
+{
+	char * rate = strtok(args, ":");
+	char * hold = strtok(0, ":");
+	char * dist = strtok(0, ":");
+	char * hmax = strtok(0, ":");
+
+	int    d;
+
+	if(!rate) {
+		LOG_MAIN("Churn must be in the form "
+			"rate[:hold_ms[:dist[:max_hold_ms]]]\n");
+		return;
+	}
+
+	sim_churn.rate = (sp)atof(rate);
+
+	if(hold) {
+		sim_churn.hold_a = (sp)atof(hold);
+		sim_churn.hold_b = sim_churn.hold_a;
+	}
+
+	if(dist) {
+		d = churn_hold_from_string(dist);
+
+		if(d < 0) {
+			LOG_MAIN("Holding time distribution %s not known!\n", dist);
+			exit(0);
+		}
+
+		sim_churn.hold = (u32)d;
+	}
+
+	if(hmax) {
+		sim_churn.hold_b = (sp)atof(hmax);
+	}
+
+	if(churn_start()) {
+		LOG_MAIN("Invalid churn configuration!\n");
+		exit(0);
+	}
+}
+
+void parse_churn_pool(char * args)
+{
+	char * base  = strtok(args, ":");
+	char * nof   = strtok(0, ":");
+	char * plmns = strtok(0, ":");
+	char * p;
+
+	if(!base || !nof || atoi(nof) <= 0) {
+		LOG_MAIN("Churn pool must be in the form imsi_base:nof_imsi\n");
+		return;
+	}
+
+	sim_churn.imsi_base = strtoull(base, 0, 10);
+	sim_churn.imsi_nof  = (u32)atoi(nof);
+
+	if(plmns) {
+		sim_churn.nof_plmn = 0;
+
+		for(p = strtok(plmns, ",");
+			p && sim_churn.nof_plmn < CHURN_PLMN_MAX;
+			p = strtok(0, ",")) {
+
+			sim_churn.plmn[sim_churn.nof_plmn++] = plmn_from_string(p);
+		}
+	}
+
+	LOG_MAIN("Churn IMSIs from %"PRIu64", %u of them, %u PLMNs\n",
+		sim_churn.imsi_base, sim_churn.imsi_nof, sim_churn.nof_plmn);
+}
+
+void parse_trace(char * args)
+{
+	char * t = strrchr(args, ':');
+
+	/* Path can contain ':' too; only a trailing number is a timeout. */
+	if(t && t[1] && strspn(t + 1, "0123456789") == strlen(t + 1)) {
+		sim_trc.timeout = (u32)atoi(t + 1);
+		*t = 0;
+	}
+
+	if(trc_open(args)) {
+		LOG_MAIN("Cannot replay trace %s!\n", args);
+		return;
+	}
+
+	LOG_MAIN("UEs leave after %u ms out of the trace\n", sim_trc.timeout);
+}
+
 void parse_args(int argc, char ** argv)
 {
 	int i;
@@ -165,6 +433,24 @@ void parse_args(int argc, char ** argv)
 			continue;
 		}
 
+		if(strcmp(argv[i], "--event") == 0) {
+			if(i + 1 >= argc) {
+				LOG_MAIN("--event miss a value\n");
+				continue;
+			}
+
+			if(ev_parse(argv[i + 1], ":", &sim_ev)) {
+				LOG_MAIN("Invalid event %s!\n", argv[i + 1]);
+				exit(0);
+			}
+
+			LOG_MAIN("Measurements reported on event %s\n",
+				ev_type_to_string(sim_ev.type));
+			i++;
+
+			continue;
+		}
+
 		if(strcmp(argv[i], "--hl") == 0) {
 			sim_hl = 1;
 
@@ -173,6 +459,214 @@ void parse_args(int argc, char ** argv)
 			continue;
 		}
 
+		if(strcmp(argv[i], "--mobility") == 0) {
+			if(i + 1 >= argc) {
+				LOG_MAIN("--mobility miss a value\n");
+				continue;
+			}
+
+			parse_mobility(argv[i + 1]);
+			i++;
+
+			continue;
+		}
+
+		if(strcmp(argv[i], "--discovery") == 0) {
+			if(i + 1 >= argc) {
+				LOG_MAIN("--discovery miss a value\n");
+				continue;
+			}
+
+			parse_discovery(argv[i + 1]);
+			i++;
+
+			continue;
+		}
+
+		if(strcmp(argv[i], "--x2_hb") == 0) {
+			if(i + 1 >= argc) {
+				LOG_MAIN("--x2_hb miss a value\n");
+				continue;
+			}
+
+			parse_x2_hb(argv[i + 1]);
+			i++;
+
+			continue;
+		}
+
+		if(strcmp(argv[i], "--neigh_timeout") == 0) {
+			if(i + 1 >= argc) {
+				LOG_MAIN("--neigh_timeout miss a value\n");
+				continue;
+			}
+
+			parse_neigh_timeout(argv[i + 1]);
+			i++;
+
+			continue;
+		}
+
+		if(strcmp(argv[i], "--shadowing") == 0) {
+			if(i + 1 >= argc) {
+				LOG_MAIN("--shadowing miss a value\n");
+				continue;
+			}
+
+			parse_shadowing(argv[i + 1]);
+			i++;
+
+			continue;
+		}
+
+		if(strcmp(argv[i], "--meas_noise") == 0) {
+			if(i + 1 >= argc) {
+				LOG_MAIN("--meas_noise miss a value\n");
+				continue;
+			}
+
+			sim_mob.meas_sd = (sp)atof(argv[i + 1]);
+			i++;
+
+			LOG_MAIN("Measurement noise of %.1f dB\n",
+				sim_mob.meas_sd);
+
+			continue;
+		}
+
+		if(strcmp(argv[i], "--l3_filter") == 0) {
+			if(i + 1 >= argc) {
+				LOG_MAIN("--l3_filter miss a value\n");
+				continue;
+			}
+
+			sim_mob.l3_k = (u32)atoi(argv[i + 1]);
+			i++;
+
+			if(sim_mob.l3_k > MOB_L3_K_MAX) {
+				sim_mob.l3_k = MOB_L3_K_MAX;
+			}
+
+			LOG_MAIN("L3 filterCoefficient %u\n", sim_mob.l3_k);
+
+			continue;
+		}
+
+		if(strcmp(argv[i], "--pos") == 0) {
+			if(i + 1 >= argc) {
+				LOG_MAIN("--pos miss a value\n");
+				continue;
+			}
+
+			parse_pos(argv[i + 1]);
+			i++;
+
+			continue;
+		}
+
+		if(strcmp(argv[i], "--meas_min") == 0) {
+			if(i + 1 >= argc) {
+				LOG_MAIN("--meas_min miss a value\n");
+				continue;
+			}
+
+			sim_meas_rsrp_min = (sp)atof(argv[i + 1]);
+			i++;
+
+			LOG_MAIN("Neighbors reported above %.2f dBm\n",
+				sim_meas_rsrp_min);
+
+			continue;
+		}
+
+		if(strcmp(argv[i], "--ue_bands") == 0) {
+			if(i + 1 >= argc) {
+				LOG_MAIN("--ue_bands miss a value\n");
+				continue;
+			}
+
+			if(ue_bands_parse(argv[i + 1], ",", sim_ue_bands) < 0) {
+				LOG_MAIN("Invalid bands %s\n", argv[i + 1]);
+			}
+
+			i++;
+
+			continue;
+		}
+
+		if(strcmp(argv[i], "--ue_rep_int") == 0) {
+			if(i + 1 >= argc) {
+				LOG_MAIN("--ue_rep_int miss a value\n");
+				continue;
+			}
+
+			sim_ue_rep_int = (u32)atoi(argv[i + 1]);
+			i++;
+
+			LOG_MAIN("UE list reported at most every %u ms\n",
+				sim_ue_rep_int);
+
+			continue;
+		}
+
+		if(strcmp(argv[i], "--rep_hold") == 0) {
+			if(i + 1 >= argc) {
+				LOG_MAIN("--rep_hold miss a value\n");
+				continue;
+			}
+
+			sim_rep.hold = (u32)atoi(argv[i + 1]);
+			i++;
+
+			LOG_MAIN("Reports held up to %u ms\n", sim_rep.hold);
+
+			continue;
+		}
+
+		if(strcmp(argv[i], "--rnti_rand") == 0) {
+			sim_rnti_rand = 1;
+
+			LOG_MAIN("RNTIs will be assigned randomly\n");
+
+			continue;
+		}
+
+		if(strcmp(argv[i], "--churn") == 0) {
+			if(i + 1 >= argc) {
+				LOG_MAIN("--churn miss a value\n");
+				continue;
+			}
+
+			parse_churn(argv[i + 1]);
+			i++;
+
+			continue;
+		}
+
+		if(strcmp(argv[i], "--churn_pool") == 0) {
+			if(i + 1 >= argc) {
+				LOG_MAIN("--churn_pool miss a value\n");
+				continue;
+			}
+
+			parse_churn_pool(argv[i + 1]);
+			i++;
+
+			continue;
+		}
+
+		if(strcmp(argv[i], "--trace") == 0) {
+			if(i + 1 >= argc) {
+				LOG_MAIN("--trace miss a value\n");
+				continue;
+			}
+
+			parse_trace(argv[i + 1]);
+			i++;
+
+			continue;
+		}
+
 		if(strcmp(argv[i], "--scenario") == 0) {
 			if(i + 1 >= argc) {
 				LOG_MAIN("Scenario is missing a path\n");
@@ -200,10 +694,6 @@ void signal_handler(int sig)
 {
 	ctrl_c = 1;
 }
-#if 1
-int sim_switch = 1;
-int sim_peak = 5;
-#endif
 int main(int argc, char ** argv) {
 	char logp[256] = {0};
 	//util_mask_all_signals();
@@ -229,6 +719,16 @@ int main(int argc, char ** argv) {
 		return 0;
 	}
 
+	/* Initialize the UE subsystem; scenarios can already add UEs. */
+	if(ue_init()) {
+		return 0;
+	}
+
+	/* Initialize the neighbors; scenarios can already add them too. */
+	if(neigh_init()) {
+		return 0;
+	}
+
 	/* Examine arguments. */
 	parse_args(argc, argv);
 
@@ -256,65 +756,22 @@ int main(int argc, char ** argv) {
 
 	/* Wait for the interface to come down... */
 	do {
-#if 1
-		if(sim_ues[0].rnti == RAN_USER_INVALID_ID) {
-			sim_peak = 5;
-			goto skip;
-		}
-
-		/* sim_switch != 0
-		 * Carrier quality increses and neighbor cell quality decreses.
+		/*
+		 * Replay the positions of the trace, if any; UEs can attach or
+		 * leave here.
 		 */
-		if(sim_switch) {
-			sim_ues[0].meas[0].rs.rsrq = sim_ues[0].meas[0].rs.rsrq - 1.0f;
-
-			if(sim_ues[0].meas[0].rs.rsrq < PHY_RSRQ_LOWER) {
-				sim_ues[0].meas[0].rs.rsrq = PHY_RSRQ_LOWER;
-				sim_peak--;
-
-				if(sim_peak <= 0) {
-					sim_peak   = 5;
-					sim_switch = !sim_switch;
-				}
-			}
-
-			/* Neighbour quality increase */
-			sim_neighs[0].rs[0].rsrq = sim_neighs[0].rs[0].rsrq + 1.0f;
+		trc_compute();
 
-			if(sim_neighs[0].rs[0].rsrq > PHY_RSRQ_HIGHER) {
-				sim_neighs[0].rs[0].rsrq = PHY_RSRQ_HIGHER;
-			}
-
-			sim_ues[0].meas[0].dirty = 1;
-		} 
-		/* sim_switch == 0
-		 * Carrier quality decreses and neighbor cell quality increses.
-		 */		
-		else {
-			/* Carrier quality increase */
-			sim_ues[0].meas[0].rs.rsrq = sim_ues[0].meas[0].rs.rsrq + 1.0f;
-
-			if(sim_ues[0].meas[0].rs.rsrq > PHY_RSRQ_HIGHER) {
-				sim_ues[0].meas[0].rs.rsrq = PHY_RSRQ_HIGHER;
-				sim_peak--;
-
-				if(sim_peak <= 0) {
-					sim_peak   = 5;
-					sim_switch = !sim_switch;
-				}
-			}
-
-			/* Neighbour quality increase */
-			sim_neighs[0].rs[0].rsrq = sim_neighs[0].rs[0].rsrq - 1.0f;
+		/*
+		 * Generate arrivals and departures of UEs, if enabled.
+		 */
+		churn_compute();
 
-			if(sim_neighs[0].rs[0].rsrq < PHY_RSRQ_LOWER) {
-				sim_neighs[0].rs[0].rsrq = PHY_RSRQ_LOWER;
-			}
+		/*
+		 * Move the UEs around and update their signal levels.
+		 */
+		mob_compute();
 
-			sim_ues[0].meas[0].dirty = 1;
-		}
-skip:
-#endif
 		/*
 		 * Perform UE simulation.
 		 * NOTE: this can generate network feedback.
@@ -326,6 +783,16 @@ skip:
 		 */
 		stack_compute();
 
+		/*
+		 * Fire the timers which expired, like periodic reports.
+		 */
+		tmr_compute();
+
+		/*
+		 * Send the reports produced so far, if held long enough.
+		 */
+		rep_compute();
+
 		/*
 		 * X2 channel for eNB-to-eNB communication.
 		 */
@@ -336,6 +803,7 @@ skip:
 	} while(iface_alive && !ctrl_c);
 
 out:
+	trc_close();
 	em_terminate_agent(sim_ID);
 	log_release();
 
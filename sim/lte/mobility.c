@@ -0,0 +1,699 @@
+/* Copyright (c) 2017 Kewin Rausch
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Empower Agent simulator UE mobility module.
+ */
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "emsim.h"
+
+#define LOG_MOB(x, ...)		LOG_TRACE(x, ##__VA_ARGS__)
+
+/* Distances below one meter are considered as one meter (squared here). */
+#define MOB_D2_MIN		1.0f
+
+/* Per-UE state of the links with a neighbor cell; same layout as the one of
+ * the serving cell.
+ */
+typedef struct __em_sim_mob_link {
+	/* Neighbor described; another one in the slot restarts the link. */
+	u32 id;
+	/* Power received, in dBm. */
+	sp  p[UE_MAX];
+	/* Shadowing, in dB. */
+	sp  sh[UE_MAX];
+	/* L3 filtered RSRP and RSRQ; 0 when the filter has still to start. */
+	sp  fp[UE_MAX];
+	sp  fq[UE_MAX];
+} em_mob_link;
+
+/******************************************************************************
+ * Globals used all around the simulator:                                     *
+ ******************************************************************************/
+
+em_mob sim_mob = {
+	.model     = MOB_MODEL_NONE,
+	.area_w    = MOB_AREA_DEFAULT,
+	.area_h    = MOB_AREA_DEFAULT,
+	.speed_min = MOB_SPEED_MIN_DEFAULT,
+	.speed_max = MOB_SPEED_MAX_DEFAULT,
+	.block     = MOB_BLOCK_DEFAULT,
+	.x         = MOB_AREA_DEFAULT / 2,
+	.y         = MOB_AREA_DEFAULT / 2,
+	.tx_power  = MOB_TX_POWER_DEFAULT,
+	.pl_ref    = MOB_PL_REF_DEFAULT,
+	.pl_exp    = MOB_PL_EXP_DEFAULT,
+	.noise     = MOB_NOISE_DEFAULT,
+	.shadow_sd = 0.0f,
+	.shadow_tc = MOB_SHADOW_TC_DEFAULT,
+	.meas_sd   = 0.0f,
+	.l3_k      = 0,
+};
+
+/*
+ * Per-UE state. Every quantity has its own array, so that each step of the
+ * computation runs over contiguous memory and can be vectorized.
+ */
+
+/* Position of the UEs, in meters. */
+sp  mob_x[UE_MAX];
+sp  mob_y[UE_MAX];
+/* Velocity of the UEs, in m/s. */
+sp  mob_vx[UE_MAX];
+sp  mob_vy[UE_MAX];
+/* Destination of the UEs, for the random waypoint model. */
+sp  mob_wx[UE_MAX];
+sp  mob_wy[UE_MAX];
+
+/* RNTI of the UE described by the slot; detects newly arrived UEs. */
+u16 mob_rnti[UE_MAX];
+
+/* Power received from the serving cell, in dBm. */
+sp  mob_srv[UE_MAX];
+/* Total power received, noise included, in mW. */
+sp  mob_tot[UE_MAX];
+/* Total power received, in dBm. */
+sp  mob_tot_db[UE_MAX];
+
+/* Shadowing of the serving cell, in dB. */
+sp  mob_sh_srv[UE_MAX];
+
+/* L3 filtered RSRP and RSRQ of the serving cell; 0 when the filter has still
+ * to start.
+ */
+sp  mob_fp_srv[UE_MAX];
+sp  mob_fq_srv[UE_MAX];
+
+/* Links with the neighbor cells, by slot; only the neighbors with a position
+ * have one, allocated the first time they are met.
+ */
+em_mob_link ** mob_lnk     = 0;
+u32            mob_nof_lnk = 0;
+
+/* Time of the next measurement of the UEs, in ms. */
+u64 mob_meas_next = 0;
+
+/* Standard normal samples for a pass over the UEs. */
+sp  mob_gs[UE_MAX];
+
+/* State of the private random generator. */
+u32 mob_seed = 1;
+
+/******************************************************************************
+ * Private procedures for mobility module only:                               *
+ ******************************************************************************/
+
+/* Returns a random number in [0, 1). */
+static inline sp mob_random(void)
+{
+	mob_seed ^= mob_seed << 13;
+	mob_seed ^= mob_seed >> 17;
+	mob_seed ^= mob_seed << 5;
+
+	return (mob_seed >> 8) * (1.0f / 16777216.0f);
+}
+
+/* Returns a random speed in the configured range. */
+static inline sp mob_speed(void)
+{
+	return sim_mob.speed_min +
+		(sim_mob.speed_max - sim_mob.speed_min) * mob_random();
+}
+
+/* Returns a standard normal sample (Box-Muller). */
+static inline sp mob_normal(void)
+{
+	sp r = sqrtf(-2.0f * logf(1.0f - mob_random()));
+
+	return r * cosf(2.0f * (sp)M_PI * mob_random());
+}
+
+/* Fills mob_gs with standard normal samples (Box-Muller). */
+static void mob_gauss(void)
+{
+	int i;
+	sp  r;
+	sp  a;
+
+	for(i = 0; i < UE_MAX; i += 2) {
+		r = sqrtf(-2.0f * logf(1.0f - mob_random()));
+		a = 2.0f * (sp)M_PI * mob_random();
+
+		mob_gs[i]     = r * cosf(a);
+		mob_gs[i + 1] = r * sinf(a);
+	}
+}
+
+/* Direct the UE toward its waypoint with a new random speed. */
+void mob_rwp_target(int i)
+{
+	sp dx;
+	sp dy;
+	sp d;
+	sp v;
+
+	mob_wx[i] = sim_mob.area_w * mob_random();
+	mob_wy[i] = sim_mob.area_h * mob_random();
+
+	dx = mob_wx[i] - mob_x[i];
+	dy = mob_wy[i] - mob_y[i];
+	d  = sqrtf(dx * dx + dy * dy);
+	v  = mob_speed();
+
+	if(d < 1.0f) {
+		mob_vx[i] = 0.0f;
+		mob_vy[i] = 0.0f;
+		return;
+	}
+
+	mob_vx[i] = dx / d * v;
+	mob_vy[i] = dy / d * v;
+}
+
+/* Gives an initial position and velocity to an UE, following the model. */
+void mob_place(int i)
+{
+	int k;
+	sp  a;
+	sp  v;
+
+	mob_x[i] = sim_mob.area_w * mob_random();
+	mob_y[i] = sim_mob.area_h * mob_random();
+
+	switch(sim_mob.model) {
+	case MOB_MODEL_RWP:
+		mob_rwp_target(i);
+		break;
+	case MOB_MODEL_LINEAR:
+		a = 2.0f * (sp)M_PI * mob_random();
+		v = mob_speed();
+
+		mob_vx[i] = cosf(a) * v;
+		mob_vy[i] = sinf(a) * v;
+		break;
+	case MOB_MODEL_MANHATTAN:
+		v = mob_speed() * (mob_random() < 0.5f ? -1.0f : 1.0f);
+
+		/* Put the UE on a street of the grid, moving along it. */
+		if(mob_random() < 0.5f) {
+			mob_y[i]  = sim_mob.block *
+				floorf(mob_y[i] / sim_mob.block);
+			mob_vx[i] = v;
+			mob_vy[i] = 0.0f;
+		} else {
+			mob_x[i]  = sim_mob.block *
+				floorf(mob_x[i] / sim_mob.block);
+			mob_vx[i] = 0.0f;
+			mob_vy[i] = v;
+		}
+		break;
+	default:
+		mob_vx[i] = 0.0f;
+		mob_vy[i] = 0.0f;
+		break;
+	}
+
+	mob_rnti[i] = sim_ues[i].rnti;
+
+	/* Fresh filters, and shadowing from its stationary distribution. */
+	mob_fp_srv[i] = 0.0f;
+	mob_fq_srv[i] = 0.0f;
+	mob_sh_srv[i] = sim_mob.shadow_sd * mob_normal();
+
+	for(k = 0; k < mob_nof_lnk; k++) {
+		if(!mob_lnk[k]) {
+			continue;
+		}
+
+		mob_lnk[k]->fp[i] = 0.0f;
+		mob_lnk[k]->fq[i] = 0.0f;
+		mob_lnk[k]->sh[i] = sim_mob.shadow_sd * mob_normal();
+	}
+}
+
+/* Returns the link with the neighbor in slot 'k', creating it if needed and
+ * restarting it if the slot changed neighbor; 0 if there is no memory.
+ */
+em_mob_link * mob_link(u32 k)
+{
+	int            i;
+	u32            c;
+	em_mob_link ** t;
+
+	if(k >= mob_nof_lnk) {
+		c = sim_neigh_cap > k ? sim_neigh_cap : k + 1;
+		t = realloc(mob_lnk, sizeof(em_mob_link *) * c);
+
+		if(!t) {
+			return 0;
+		}
+
+		memset(t + mob_nof_lnk, 0,
+			sizeof(em_mob_link *) * (c - mob_nof_lnk));
+
+		mob_lnk     = t;
+		mob_nof_lnk = c;
+	}
+
+	if(!mob_lnk[k]) {
+		mob_lnk[k] = malloc(sizeof(em_mob_link));
+
+		if(!mob_lnk[k]) {
+			LOG_MOB("No memory for the links of neighbor %u\n",
+				sim_neighs[k]->id);
+			return 0;
+		}
+
+		mob_lnk[k]->id = NEIGH_INVALID_ID;
+	}
+
+	/* New neighbor in the slot; its history is not ours. */
+	if(mob_lnk[k]->id != sim_neighs[k]->id) {
+		mob_lnk[k]->id = sim_neighs[k]->id;
+
+		for(i = 0; i < UE_MAX; i++) {
+			mob_lnk[k]->fp[i] = 0.0f;
+			mob_lnk[k]->fq[i] = 0.0f;
+			mob_lnk[k]->sh[i] = sim_mob.shadow_sd * mob_normal();
+		}
+	}
+
+	return mob_lnk[k];
+}
+
+/* Keep the UE inside the area by bouncing on the borders. */
+static inline void mob_bounce(int i)
+{
+	if(mob_x[i] < 0.0f) {
+		mob_x[i]  = -mob_x[i];
+		mob_vx[i] = -mob_vx[i];
+	} else if(mob_x[i] > sim_mob.area_w) {
+		mob_x[i]  = 2.0f * sim_mob.area_w - mob_x[i];
+		mob_vx[i] = -mob_vx[i];
+	}
+
+	if(mob_y[i] < 0.0f) {
+		mob_y[i]  = -mob_y[i];
+		mob_vy[i] = -mob_vy[i];
+	} else if(mob_y[i] > sim_mob.area_h) {
+		mob_y[i]  = 2.0f * sim_mob.area_h - mob_y[i];
+		mob_vy[i] = -mob_vy[i];
+	}
+}
+
+/* Turn the UE at the crossings of the Manhattan grid it passed. */
+void mob_manhattan_turn(int i, sp dt)
+{
+	sp o;  /* Old coordinate along the direction of movement. */
+	sp c;  /* Crossing passed, if any. */
+	sp v;
+	sp r;
+
+	if(mob_vx[i] != 0.0f) {
+		o = mob_x[i] - mob_vx[i] * dt;
+		c = sim_mob.block * (mob_vx[i] > 0.0f ?
+			floorf(mob_x[i] / sim_mob.block) :
+			ceilf(mob_x[i] / sim_mob.block));
+
+		if((c - o) * (c - mob_x[i]) > 0.0f || c == o) {
+			return;
+		}
+
+		v = fabsf(mob_vx[i]);
+	} else {
+		o = mob_y[i] - mob_vy[i] * dt;
+		c = sim_mob.block * (mob_vy[i] > 0.0f ?
+			floorf(mob_y[i] / sim_mob.block) :
+			ceilf(mob_y[i] / sim_mob.block));
+
+		if((c - o) * (c - mob_y[i]) > 0.0f || c == o) {
+			return;
+		}
+
+		v = fabsf(mob_vy[i]);
+	}
+
+	r = mob_random();
+
+	/* Half of the times go straight on. */
+	if(r < 0.5f) {
+		return;
+	}
+
+	v = r < 0.75f ? v : -v;
+
+	/* Stop at the crossing, and take the other street. */
+	if(mob_vx[i] != 0.0f) {
+		mob_x[i]  = c;
+		mob_vx[i] = 0.0f;
+		mob_vy[i] = v;
+	} else {
+		mob_y[i]  = c;
+		mob_vx[i] = v;
+		mob_vy[i] = 0.0f;
+	}
+}
+
+/* Model-specific adjustments which follow the movement of an UE. */
+void mob_steer(int i, sp dt)
+{
+	switch(sim_mob.model) {
+	case MOB_MODEL_RWP:
+		/* Waypoint passed; snap on it and choose the next one. */
+		if((mob_wx[i] - mob_x[i]) * mob_vx[i] +
+			(mob_wy[i] - mob_y[i]) * mob_vy[i] <= 0.0f) {
+
+			mob_x[i] = mob_wx[i];
+			mob_y[i] = mob_wy[i];
+
+			mob_rwp_target(i);
+		}
+		break;
+	case MOB_MODEL_LINEAR:
+		mob_bounce(i);
+		break;
+	case MOB_MODEL_MANHATTAN:
+		mob_manhattan_turn(i, dt);
+		mob_bounce(i);
+		break;
+	}
+}
+
+/* Compute the power received at each UE position from a cell located in
+ * (x, y), shadowing 'sh' included, and accumulate it in the total power
+ * received by the UE. Shadowing moves on of 'dt' seconds.
+ */
+static void mob_path_loss(sp * out, sp * sh, sp x, sp y, sp dt)
+{
+	int i;
+	sp  dx;
+	sp  dy;
+	sp  d2;
+	sp  c;
+	sp  w;
+
+	if(sim_mob.shadow_sd > 0.0f) {
+		/* First order autoregressive process, with the variance of the
+		 * shadowing as stationary one.
+		 */
+		c = expf(-dt * 1000.0f / fmaxf(sim_mob.shadow_tc, 1.0f));
+		w = sim_mob.shadow_sd * sqrtf(1.0f - c * c);
+
+		mob_gauss();
+
+		for(i = 0; i < UE_MAX; i++) {
+			sh[i] = c * sh[i] + w * mob_gs[i];
+		}
+	}
+
+	for(i = 0; i < UE_MAX; i++) {
+		dx = mob_x[i] - x;
+		dy = mob_y[i] - y;
+		d2 = fmaxf(dx * dx + dy * dy, MOB_D2_MIN);
+
+		/* 10 * n * log10(d) computed on the squared distance. */
+		out[i] = sim_mob.tx_power + sh[i] -
+			(sim_mob.pl_ref + 5.0f * sim_mob.pl_exp * log10f(d2));
+
+		mob_tot[i] += powf(10.0f, out[i] / 10.0f);
+	}
+}
+
+/* Clamp a level in the given range. */
+static inline sp mob_clamp(sp v, sp l, sp h)
+{
+	return v < l ? l : (v > h ? h : v);
+}
+
+/* Measures the powers 'p' received from a cell: noise is added, RSRQ derived
+ * from the total power received, and both go through the L3 filters 'fp' and
+ * 'fq' with weight 'a'. A filter at 0 starts from the measurement.
+ */
+static void mob_measure(sp * p, sp * fp, sp * fq, sp a)
+{
+	int i;
+	sp  m;
+	sp  q;
+
+	if(sim_mob.meas_sd > 0.0f) {
+		mob_gauss();
+	}
+
+	for(i = 0; i < UE_MAX; i++) {
+		m = p[i] + (sim_mob.meas_sd > 0.0f ?
+			sim_mob.meas_sd * mob_gs[i] : 0.0f);
+
+		/* Simplified RSRQ: best quality, scaled by the signal share
+		 * over the total power received (interference and noise).
+		 */
+		q = mob_clamp(PHY_RSRQ_HIGHER + m - mob_tot_db[i],
+			PHY_RSRQ_LOWER, PHY_RSRQ_HIGHER);
+		m = mob_clamp(m, PHY_RSRP_LOWER, PHY_RSRP_HIGHER);
+
+		fp[i] = fp[i] == 0.0f ? m : fp[i] + a * (m - fp[i]);
+		fq[i] = fq[i] == 0.0f ? q : fq[i] + a * (q - fq[i]);
+	}
+}
+
+/* Store a reference signal level as report ranges, and tell if they change;
+ * smaller changes are not propagated.
+ */
+static inline int mob_store(em_phy_rs * rs, sp rsrp, sp rsrq)
+{
+	em_phy_rs n;
+
+	n.rsrp = phy_rsrp_to_range(rsrp);
+	n.rsrq = phy_rsrq_to_range(rsrq);
+
+	if(n.rsrp == rs->rsrp && n.rsrq == rs->rsrq) {
+		return 0;
+	}
+
+	*rs = n;
+	return 1;
+}
+
+/******************************************************************************
+ * Public accessible procedures:                                              *
+ ******************************************************************************/
+
+int mob_model_from_string(char * name)
+{
+	if(strcmp(name, "none") == 0) {
+		return MOB_MODEL_NONE;
+	}
+
+	if(strcmp(name, "rwp") == 0) {
+		return MOB_MODEL_RWP;
+	}
+
+	if(strcmp(name, "linear") == 0) {
+		return MOB_MODEL_LINEAR;
+	}
+
+	if(strcmp(name, "manhattan") == 0) {
+		return MOB_MODEL_MANHATTAN;
+	}
+
+	if(strcmp(name, "trace") == 0) {
+		return MOB_MODEL_TRACE;
+	}
+
+	return ERR_MOB_MODEL_UNKNOWN;
+}
+
+char * mob_model_to_string(u32 model)
+{
+	switch(model) {
+	case MOB_MODEL_RWP:
+		return "rwp";
+	case MOB_MODEL_LINEAR:
+		return "linear";
+	case MOB_MODEL_MANHATTAN:
+		return "manhattan";
+	case MOB_MODEL_TRACE:
+		return "trace";
+	}
+
+	return "none";
+}
+
+int mob_set_pos(int ue, sp x, sp y)
+{
+	if(ue < 0 || ue >= UE_MAX || sim_ues[ue].rnti == UE_RNTI_INVALID) {
+		return ERR_MOB_POS_UE;
+	}
+
+	/* Make sure that the UE will not be placed randomly later. */
+	if(mob_rnti[ue] != sim_ues[ue].rnti) {
+		mob_place(ue);
+	}
+
+	mob_x[ue] = mob_clamp(x, 0.0f, sim_mob.area_w);
+	mob_y[ue] = mob_clamp(y, 0.0f, sim_mob.area_h);
+
+	if(sim_mob.model == MOB_MODEL_RWP) {
+		mob_rwp_target(ue);
+	}
+
+	return SUCCESS;
+}
+
+/******************************************************************************
+ * Mobility simulation logic:                                                 *
+ ******************************************************************************/
+
+u32 mob_compute(void)
+{
+	int i;
+	int k;
+	int d;
+	u32 n;
+	u64 now;
+
+	em_phy_rs     rs;
+	em_mob_link * l;
+
+	sp  dt = sim_loop_int / 1000.0f;
+	sp  nl = powf(10.0f, sim_mob.noise / 10.0f);
+	/* Weight of the new measurements in the L3 filter. */
+	sp  a  = powf(2.0f, -(sp)sim_mob.l3_k / 4.0f);
+
+	if(sim_mob.model == MOB_MODEL_NONE) {
+		return SUCCESS;
+	}
+
+	if(mob_seed == 1) {
+		mob_seed = (u32)time(NULL) | 1;
+	}
+
+	/* New UEs in the cell start from a random point. */
+	for(i = 0; i < UE_MAX; i++) {
+		if(sim_ues[i].rnti != UE_RNTI_INVALID &&
+			sim_ues[i].rnti != mob_rnti[i]) {
+
+			mob_place(i);
+		}
+	}
+
+	/*
+	 * Movement; all the slots are processed, used or not, to keep the
+	 * loops free of branches.
+	 */
+
+	for(i = 0; i < UE_MAX; i++) {
+		mob_x[i] += mob_vx[i] * dt;
+		mob_y[i] += mob_vy[i] * dt;
+		mob_tot[i] = nl;
+	}
+
+	for(i = 0; i < UE_MAX; i++) {
+		if(sim_ues[i].rnti != UE_RNTI_INVALID) {
+			mob_steer(i, dt);
+		}
+	}
+
+	/*
+	 * Received powers:
+	 */
+
+	mob_path_loss(mob_srv, mob_sh_srv, sim_mob.x, sim_mob.y, dt);
+
+	for(n = 0; n < sim_nof_neigh; n++) {
+		k = sim_neigh_act[n];
+
+		if(!sim_neighs[k]->located || !(l = mob_link(k))) {
+			continue;
+		}
+
+		mob_path_loss(l->p, l->sh, sim_neighs[k]->x, sim_neighs[k]->y,
+			dt);
+	}
+
+	/*
+	 * Measurements, one every MOB_MEAS_PERIOD whatever the step of the
+	 * loop, so that the smoothing of the L3 filter does not depend on it:
+	 */
+
+	now = tmr_now();
+
+	/* First run, or too late to catch up: sample from now on. */
+	if(mob_meas_next + MOB_MEAS_PERIOD * MOB_MEAS_LATE < now) {
+		mob_meas_next = now;
+	}
+
+	if(mob_meas_next > now) {
+		return SUCCESS;
+	}
+
+	for(i = 0; i < UE_MAX; i++) {
+		mob_tot_db[i] = 10.0f * log10f(mob_tot[i]);
+	}
+
+	/* A loop slower than the period takes a sample for each one. */
+	for(; mob_meas_next <= now; mob_meas_next += MOB_MEAS_PERIOD) {
+		mob_measure(mob_srv, mob_fp_srv, mob_fq_srv, a);
+
+		for(n = 0; n < sim_nof_neigh; n++) {
+			k = sim_neigh_act[n];
+
+			if(sim_neighs[k]->located && (l = mob_link(k))) {
+				mob_measure(l->p, l->fp, l->fq, a);
+			}
+		}
+	}
+
+	/*
+	 * Write back the levels, and ask for a report if they changed:
+	 */
+
+	for(i = 0; i < UE_MAX; i++) {
+		if(sim_ues[i].rnti == UE_RNTI_INVALID) {
+			continue;
+		}
+
+		d = mob_store(&sim_ues[i].meas[0].rs, mob_fp_srv[i],
+			mob_fq_srv[i]);
+
+		for(n = 0; n < sim_nof_neigh; n++) {
+			k = sim_neigh_act[n];
+
+			if(!sim_neighs[k]->located ||
+				!ue_band_has(i, sim_neighs[k]->band) ||
+				!(l = mob_link(k))) {
+
+				continue;
+			}
+
+			ue_ngh_get(i, k, &rs);
+
+			if(mob_store(&rs, l->fp[i], l->fq[i])) {
+				ue_ngh_set(i, k, &rs);
+				d = 1;
+			}
+		}
+
+		if(d) {
+			ue_meas_dirty(i, 0);
+		}
+	}
+
+	return SUCCESS;
+}
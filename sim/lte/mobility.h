@@ -0,0 +1,155 @@
+/* Copyright (c) 2017 Kewin Rausch
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Empower Agent simulator UE mobility module.
+ *
+ * UEs move inside a rectangular area following one of the available mobility
+ * models, while the level of the reference signals they receive from this
+ * eNB and from the neighbor ones is computed with a log-distance path loss
+ * model, using the positions configured for the cells.
+ *
+ * Received powers can vary with log-normal shadowing, correlated in time.
+ * UEs measure them with some gaussian noise, and smooth the measurements
+ * with the layer 3 filter of 3GPP TS 36.331 (5.5.3.2):
+ *
+ *      Fn = (1 - a) * Fn-1 + a * Mn,  a = 1 / 2^(k / 4)
+ *
+ * where k is the filterCoefficient; k = 0 disables the filter.
+ */
+
+#ifndef __EM_SIM_MOBILITY_H
+#define __EM_SIM_MOBILITY_H
+
+#include <emtypes.h>
+
+/* Default size of the area, in meters. */
+#define MOB_AREA_DEFAULT		1000.0f
+
+/* Default speed range of the UEs, in m/s. */
+#define MOB_SPEED_MIN_DEFAULT		1.0f
+#define MOB_SPEED_MAX_DEFAULT		15.0f
+
+/* Default size of a block for the Manhattan grid, in meters. */
+#define MOB_BLOCK_DEFAULT		100.0f
+
+/* Default RS power per resource element, in dBm. */
+#define MOB_TX_POWER_DEFAULT		15.0f
+/* Default path loss at one meter, in dB. */
+#define MOB_PL_REF_DEFAULT		38.0f
+/* Default path loss exponent. */
+#define MOB_PL_EXP_DEFAULT		3.5f
+/* Default thermal noise per resource element, in dBm. */
+#define MOB_NOISE_DEFAULT		-125.0f
+
+/* Default correlation time of the shadowing, in ms. */
+#define MOB_SHADOW_TC_DEFAULT		5000.0f
+
+/* Highest filterCoefficient of the L3 filter. */
+#define MOB_L3_K_MAX			19
+/* Time between two measurements of the UEs, in ms; the L3 filter assumes one
+ * sample per period.
+ */
+#define MOB_MEAS_PERIOD			200
+/* Periods a late loop samples again at once; further ones are skipped. */
+#define MOB_MEAS_LATE			10
+
+/* Mobility models which can be selected. */
+enum mob_models {
+	/* UEs do not move; signal levels are left to the user. */
+	MOB_MODEL_NONE = 0,
+	/* Random waypoint: reach a random point, then pick another one. */
+	MOB_MODEL_RWP,
+	/* Straight line with constant velocity, bouncing on the borders. */
+	MOB_MODEL_LINEAR,
+	/* Move along the streets of a grid, turning at the crossings. */
+	MOB_MODEL_MANHATTAN,
+	/* Positions are replayed from a trace file; see trace.h. */
+	MOB_MODEL_TRACE,
+};
+
+/* Describes the mobility subsystem configuration. */
+typedef struct __em_sim_mobility {
+	/* Model in use. */
+	u32 model;
+
+	/* Width of the area where UEs move, in meters. */
+	sp  area_w;
+	/* Height of the area where UEs move, in meters. */
+	sp  area_h;
+
+	/* Minimum speed of an UE, in m/s. */
+	sp  speed_min;
+	/* Maximum speed of an UE, in m/s. */
+	sp  speed_max;
+
+	/* Size of a block of the Manhattan grid, in meters. */
+	sp  block;
+
+	/* Position of this eNB cells, in meters. */
+	sp  x;
+	sp  y;
+
+	/* RS power per resource element, in dBm. */
+	sp  tx_power;
+	/* Path loss at one meter, in dB. */
+	sp  pl_ref;
+	/* Path loss exponent. */
+	sp  pl_exp;
+	/* Thermal noise per resource element, in dBm. */
+	sp  noise;
+
+	/* Standard deviation of the shadowing, in dB; 0 disables it. */
+	sp  shadow_sd;
+	/* Time after which shadowing is correlated by 1/e, in ms. */
+	sp  shadow_tc;
+	/* Standard deviation of the measurement noise, in dB. */
+	sp  meas_sd;
+	/* filterCoefficient of the L3 filter. */
+	u32 l3_k;
+} em_mob;
+
+/******************************************************************************
+ * Globals used all around the simulator:                                     *
+ ******************************************************************************/
+
+/* Mobility configuration. */
+extern em_mob sim_mob;
+
+/******************************************************************************
+ * Public accessible procedures:                                              *
+ ******************************************************************************/
+
+/* Translate the name of a model in its identifier.
+ * Returns the model, or a negative error code if the name is unknown.
+ */
+int mob_model_from_string(char * name);
+
+/* Returns the name of the given mobility model. */
+char * mob_model_to_string(u32 model);
+
+/* Moves an UE in a given position of the area.
+ * Returns 0 on success, otherwise a negative error code.
+ */
+int mob_set_pos(int ue, sp x, sp y);
+
+/* Performs a step of the mobility simulation: UEs are moved and the levels of
+ * the reference signals for the serving and neighbor cells are updated.
+ *
+ * Returns 0 on success, otherwise a negative error code.
+ */
+u32 mob_compute(void);
+
+#endif /* __EM_SIM_MOBILITY_H */
@@ -17,7 +17,9 @@
  * Empower Agent simulator neighbor cell modules.
  */
 
+#include <stdlib.h>
 #include <string.h>
+#include <time.h>
 
 #include "emsim.h"
 
@@ -27,83 +29,307 @@
  * Globals used all around the simulator:                                     *
  ******************************************************************************/
 
-/* PHY layer used. */
-em_neigh sim_neighs[NEIGH_MAX] = {{0}};
+/* Neighbor slots; the objects never move, while the table can grow. */
+em_neigh ** sim_neighs = 0;
+
+/* Number of slots in the table. */
+u32 sim_neigh_cap = 0;
 
 /* Number of neighbors actual in use. */
 u32 sim_nof_neigh = 0;
 
+/* Slots of the neighbors in use, so that who needs them all does not have to
+ * look through the free ones.
+ */
+int * sim_neigh_act = 0;
+
+/* Silence after which a neighbor becomes suspect, in ms. */
+u32 sim_neigh_suspect = NEIGH_SUSPECT_DEFAULT;
+/* Silence after which a neighbor is considered dead, in ms. */
+u32 sim_neigh_dead    = NEIGH_DEAD_DEFAULT;
+
 /******************************************************************************
- * Public accessible procedures:                                              *
+ * Private procedures for neighbor module only:                               *
  ******************************************************************************/
 
-int neigh_add_ipv4(u32 id, u16 pci, char * ipv4, int port)
+/* Neighbor slots indexed by eNB id. */
+em_hash neigh_id_idx   = {0};
+/* Neighbor slots indexed by IPv4 address and port. */
+em_hash neigh_addr_idx = {0};
+
+/* Key of the address index: IPv4 and port, both in network order. */
+static inline u64 neigh_addr_key(struct sockaddr_in * addr)
 {
-	int i;
-	int f = -1; /* First free. */
+	return ((u64)addr->sin_addr.s_addr << 16) | addr->sin_port;
+}
+
+/* Doubles the neighbor table, up to NEIGH_MAX slots.
+ * Returns 0 on success, otherwise a negative error code.
+ */
+int neigh_grow(void)
+{
+	u32         i;
+	u32         c = sim_neigh_cap ? sim_neigh_cap * 2 : NEIGH_INIT;
+	em_neigh ** t;
+	int *       a;
+
+	if(c > NEIGH_MAX) {
+		c = NEIGH_MAX;
+	}
+
+	if(c <= sim_neigh_cap) {
+		return ERR_NEI_ADD_FULL;
+	}
+
+	t = realloc(sim_neighs, sizeof(em_neigh *) * c);
+
+	if(!t) {
+		return ERR_NEI_ADD_MEM;
+	}
+
+	sim_neighs = t;
+
+	a = realloc(sim_neigh_act, sizeof(int) * c);
+
+	if(!a) {
+		return ERR_NEI_ADD_MEM;
+	}
+
+	sim_neigh_act = a;
+
+	/* Timers are linked in the wheel, so neighbors are allocated apart. */
+	for(i = sim_neigh_cap; i < c; i++) {
+		sim_neighs[i] = calloc(1, sizeof(em_neigh));
 
-	for(i = 0; i < NEIGH_MAX; i++) {
-		if(f < 0 && sim_neighs[i].id == NEIGH_INVALID_ID) {
-			f = i;
+		if(!sim_neighs[i]) {
+			break;
 		}
 
-		if(id == sim_neighs[i].id) {
-			LOG_NEIGH("Neighbor %u already exists!\n", id);
-			return ERR_NEI_ADD_EXISTS;
+		sim_neighs[i]->slot = i;
+	}
+
+	if(i == sim_neigh_cap) {
+		return ERR_NEI_ADD_MEM;
+	}
+
+	LOG_NEIGH("Neighbor table now has %u slots.\n", i);
+
+	sim_neigh_cap = i;
+
+	return SUCCESS;
+}
+
+/* Takes the neighbor in slot 'n' out of the active ones. */
+void neigh_park(int n)
+{
+	u32 a;
+
+	for(a = 0; a < sim_nof_neigh; a++) {
+		if(sim_neigh_act[a] == n) {
+			sim_neigh_act[a] = sim_neigh_act[--sim_nof_neigh];
+			break;
 		}
 	}
 
-	if(f < 0) {
+	/* Probed by its liveness timer from now on. */
+	x2_hb_stop(n);
+}
+
+/* A neighbor stayed silent for the whole period of its liveness timer. */
+void neigh_live_timeout(em_timer * t)
+{
+	em_neigh * e = tmr_entry(t, em_neigh, live);
+	int        n = e->slot;
+
+	switch(e->state) {
+	case NEIGH_STATE_ALIVE:
+		LOG_NEIGH("eNB %u is suspect.\n", e->id);
+
+		e->state = NEIGH_STATE_SUSPECT;
+		tmr_arm(t, sim_neigh_dead > sim_neigh_suspect ?
+			sim_neigh_dead - sim_neigh_suspect : 0);
+		break;
+	case NEIGH_STATE_SUSPECT:
+		/* Who came from the network goes back to it. */
+		if(e->learnt) {
+			LOG_NEIGH("eNB %u is dead; evicted.\n", e->id);
+			neigh_rem(e->id);
+			break;
+		}
+
+		LOG_NEIGH("eNB %u is dead; parked.\n", e->id);
+
+		e->state = NEIGH_STATE_DEAD;
+		/* Parked, but kept probing, slowly. */
+		neigh_park(n);
+		/* Fall through. */
+	case NEIGH_STATE_DEAD:
+		x2_present(n);
+		tmr_arm(t, sim_neigh_dead);
+		break;
+	}
+}
+
+/******************************************************************************
+ * Public accessible procedures:                                              *
+ ******************************************************************************/
+
+int neigh_add_addr(u32 id, u16 pci, struct sockaddr_in * addr)
+{
+	u32 f; /* First free. */
+
+	if(hash_get(&neigh_id_idx, id) != HASH_INVALID) {
+		LOG_NEIGH("Neighbor %u already exists!\n", id);
+		return ERR_NEI_ADD_EXISTS;
+	}
+
+	for(f = 0; f < sim_neigh_cap; f++) {
+		if(sim_neighs[f]->id == NEIGH_INVALID_ID) {
+			break;
+		}
+	}
+
+	/* Table full; the first new slot is free. */
+	if(f == sim_neigh_cap && neigh_grow()) {
 		LOG_NEIGH("No more free neighbors slot!\n");
 		return ERR_NEI_ADD_FULL;
 	}
 
-	/* Power of all the UE with this new neighbors is at minimum... */
-	for(i = 0; i < UE_MAX; i++) {
-		sim_neighs[f].rs[i].rsrp = PHY_RSRP_LOWER;
-		sim_neighs[f].rs[i].rsrq = PHY_RSRQ_LOWER;
-	}
+	sim_neighs[f]->id  = id;
+	sim_neighs[f]->pci = pci;
+
+	/* Signal levels are left to the user until a position is given. */
+	sim_neighs[f]->located = 0;
+
+	/* Frequency unknown: every UE sees the cell until one is given. */
+	sim_neighs[f]->earfcn = 0;
+	sim_neighs[f]->band   = PHY_BAND_INVALID;
+
+	memset(&sim_neighs[f]->saddr, 0, sizeof(struct sockaddr_in));
+	sim_neighs[f]->saddr.sin_family = AF_INET;
+	sim_neighs[f]->saddr.sin_addr   = addr->sin_addr;
+	sim_neighs[f]->saddr.sin_port   = addr->sin_port;
+
+	/* The string is only shown to the user. */
+	inet_ntop(AF_INET, &addr->sin_addr, sim_neighs[f]->ipv4, 16);
+
+	/* Nobody has contacted us yet. */
+	memset(&sim_neighs[f]->last_seen, 0, sizeof(struct timespec));
 
-	sim_neighs[f].id  = id;
-	sim_neighs[f].pci = pci;
+	sim_neighs[f]->state  = NEIGH_STATE_UNKNOWN;
+	sim_neighs[f]->learnt = 0;
+	tmr_init(&sim_neighs[f]->live, neigh_live_timeout, 0);
 
-	memcpy(sim_neighs[f].ipv4, ipv4, strnlen(ipv4, 16));
+	sim_neighs[f]->hb_tx = 0;
+	sim_neighs[f]->hb_rx = 0;
+	sim_neighs[f]->load  = 0;
+	x2_hb_start(f);
 
-	inet_pton(AF_INET, sim_neighs[f].ipv4, &(sim_neighs[f].saddr.sin_addr));
-	sim_neighs[f].saddr.sin_port = htons(port);
+	hash_put(&neigh_id_idx, id, f);
+	hash_put(&neigh_addr_idx, neigh_addr_key(&sim_neighs[f]->saddr), f);
 
 	/* Increment the number of known eNBs. */
-	sim_nof_neigh++;
+	sim_neigh_act[sim_nof_neigh++] = f;
 
 	LOG_NEIGH("eNB %u (%d) is now known at address %s:%u.\n",
-		sim_neighs[f].id, f,
-		sim_neighs[f].ipv4,
-		ntohs(sim_neighs[f].saddr.sin_port));
+		sim_neighs[f]->id, f,
+		sim_neighs[f]->ipv4,
+		ntohs(sim_neighs[f]->saddr.sin_port));
 
 	return f;
 }
 
+int neigh_add_ipv4(u32 id, u16 pci, char * ipv4, int port)
+{
+	struct sockaddr_in addr = {0};
+
+	if(inet_pton(AF_INET, ipv4, &addr.sin_addr) != 1) {
+		LOG_NEIGH("Invalid address %s for neighbor %u\n", ipv4, id);
+		return ERR_NEI_ADD_ADDR;
+	}
+
+	addr.sin_port = htons(port);
+
+	return neigh_add_addr(id, pci, &addr);
+}
+
+int neigh_find_id(u32 id)
+{
+	return hash_get(&neigh_id_idx, id);
+}
+
+int neigh_find_addr(struct sockaddr_in * addr)
+{
+	return hash_get(&neigh_addr_idx, neigh_addr_key(addr));
+}
+
+void neigh_seen(int n)
+{
+	em_neigh * e = sim_neighs[n];
+
+	clock_gettime(CLOCK_REALTIME, &e->last_seen);
+
+	if(e->state == NEIGH_STATE_DEAD) {
+		LOG_NEIGH("eNB %u is back.\n", e->id);
+		sim_neigh_act[sim_nof_neigh++] = n;
+		x2_hb_start(n);
+	}
+
+	e->state = NEIGH_STATE_ALIVE;
+
+	/* Keep the old behavior: never give up on a neighbor. */
+	if(sim_neigh_suspect) {
+		tmr_arm(&e->live, sim_neigh_suspect);
+	}
+}
+
 int neigh_rem(u32 id)
 {
 	int i;
+	u64 k;
 
-	/* Search... */
-	for(i = 0; i < NEIGH_MAX; i++) {
-		if(sim_neighs[i].id == id) {
-			LOG_NEIGH("eNB %u removed.\n", sim_neighs[i].id);
+	i = hash_get(&neigh_id_idx, id);
 
-			/* Decrement the number of known eNBs. */
-			if(sim_nof_neigh > 0) {
-				sim_nof_neigh--;
-			}
+	if(i < 0) {
+		return ERR_NEI_REM_NOT_FOUND;
+	}
 
-			//memset(&sim_neighs[i], 0, sizeof(em_neigh));
-			sim_neighs[i].id = NEIGH_INVALID_ID;
+	LOG_NEIGH("eNB %u removed.\n", sim_neighs[i]->id);
 
-			return SUCCESS;
-		}
+	/* Decrement the number of known eNBs; dead ones are already out. */
+	neigh_park(i);
+	tmr_cancel(&sim_neighs[i]->live);
+
+	/* No UE hears it anymore, so the slot starts clean when reused. */
+	ue_ngh_drop(i);
+
+	hash_del(&neigh_id_idx, id);
+
+	/* Another neighbor could have taken over the same address. */
+	k = neigh_addr_key(&sim_neighs[i]->saddr);
+
+	if(hash_get(&neigh_addr_idx, k) == i) {
+		hash_del(&neigh_addr_idx, k);
 	}
 
-	return ERR_NEI_REM_NOT_FOUND;
+	sim_neighs[i]->id = NEIGH_INVALID_ID;
+
+	return SUCCESS;
 }
 
+int neigh_init(void)
+{
+	if(hash_init(&neigh_id_idx, NEIGH_MAX) ||
+		hash_init(&neigh_addr_idx, NEIGH_MAX)) {
+
+		LOG_NEIGH("Cannot allocate neighbor indexes!\n");
+		return ERR_NEI_INIT_INDEX;
+	}
+
+	if(neigh_grow()) {
+		LOG_NEIGH("Cannot allocate the neighbor table!\n");
+		return ERR_NEI_INIT_INDEX;
+	}
+
+	return SUCCESS;
+}
@@ -29,51 +29,135 @@
 /* Neigh with this identifier are considered as invalid. */
 #define NEIGH_INVALID_ID		0
 
+/* Neighbor slots prepared at start; the table doubles when full. */
+#define NEIGH_INIT			16
 /* Maximum number of neighbors taken into account. */
-#define NEIGH_MAX			10
+#define NEIGH_MAX			4096
+
+/* Silence after which a neighbor becomes suspect, in ms. */
+#define NEIGH_SUSPECT_DEFAULT		2500
+/* Silence after which a neighbor is considered dead, in ms. */
+#define NEIGH_DEAD_DEFAULT		10000
+
+/* Liveness states of a neighbor. */
+enum neigh_states {
+	/* Never heard of; configured neighbors start here. */
+	NEIGH_STATE_UNKNOWN = 0,
+	/* ALIVE messages are arriving. */
+	NEIGH_STATE_ALIVE,
+	/* Silent for a while, but still used. */
+	NEIGH_STATE_SUSPECT,
+	/* Silent for too long; parked out of the active neighbors. */
+	NEIGH_STATE_DEAD,
+};
 
 /* Describes how a neighbor cell is seen by this one. */
 typedef struct __em_sim_neighbor {
 	/* Id of the agent which handles such cell. */
 	u32 id;
+	/* Slot of the neighbor in the table. */
+	u32 slot;
 
 	/* PCI of the neighbor cell. */
 	u32 pci;
-
-	/* Reference signal power/quality per UE. */
-	em_phy_rs rs[UE_MAX];
-
-	/* Human-readable IPv4 address. */
+	/* Downlink EARFCN of the neighbor cell; 0 if not known. */
+	u32 earfcn;
+	/* Band of the neighbor cell; PHY_BAND_INVALID if not known. */
+	u32 band;
+
+	/* Position of the neighbor cell, in meters. */
+	sp x;
+	sp y;
+	/* Has a position been given to the cell? */
+	u32 located;
+
+	/* Human-readable IPv4 address, for display only. */
 	char ipv4[16];
 	/* Human-readable IPv6 address. */
 	char ipv6[32];
 
-	/* Socket compatible address. */
+	/* Socket compatible address; key of the address index. */
 	struct sockaddr_in saddr;
 
 	/* Last time this neighbor contacted us. */
 	struct timespec last_seen;
+
+	/* Liveness state of the neighbor. */
+	u32      state;
+	/* Has the neighbor been learnt from the network, not configured? */
+	u32      learnt;
+	/* Moves the neighbor to the next state when it stays silent. */
+	em_timer live;
+
+	/* Next heartbeat to this neighbor. */
+	em_timer hb;
+	/* Is an heartbeat waiting for the next send stage? */
+	u32      hb_due;
+	/* Heartbeats sent to and received from this neighbor. */
+	u64      hb_tx;
+	u64      hb_rx;
+	/* UEs attached to the neighbor, as told by its heartbeats. */
+	u32      load;
 } em_neigh;
 
 /******************************************************************************
  * Globals used all around the simulator:                                     *
  ******************************************************************************/
 
-/* PHY layer used. */
-extern em_neigh sim_neighs[NEIGH_MAX];
+/* Neighbor slots; the objects never move, while the table can grow. */
+extern em_neigh ** sim_neighs;
+
+/* Number of slots in the table. */
+extern u32 sim_neigh_cap;
 
 /* Number of neighbors actual in use. */
 extern u32 sim_nof_neigh;
 
+/* Slots of the neighbors in use; the first sim_nof_neigh are valid.
+ * Dead neighbors are not part of it.
+ */
+extern int * sim_neigh_act;
+
+/* Silence after which a neighbor becomes suspect, in ms. */
+extern u32 sim_neigh_suspect;
+/* Silence after which a neighbor is considered dead, in ms. */
+extern u32 sim_neigh_dead;
+
 /******************************************************************************
  * Public accessible procedures:                                              *
  ******************************************************************************/
 
+/* Prepare a neighbor slot in order to describe the cell reachable at the
+ * given socket address.
+ * Returns the chosen index, or a negative number on error.
+ */
+int neigh_add_addr(u32 id, u16 pci, struct sockaddr_in * addr);
+
 /* Prepare a neighbor slot in order to describe the given cell.
  * Returns the chosen index, or a negative number on error.
  */
 int neigh_add_ipv4(u32 id, u16 pci, char * ipv4, int port);
 
+/* Look for the slot of a neighbor using its eNB id.
+ * Returns the neighbor slot index, or a negative number if not found.
+ */
+int neigh_find_id(u32 id);
+
+/* Look for the slot of a neighbor using the address it sends from.
+ * Returns the neighbor slot index, or a negative number if not found.
+ */
+int neigh_find_addr(struct sockaddr_in * addr);
+
+/* Signals that the neighbor in slot 'n' has been heard of; brings it back
+ * among the active ones if it was dead.
+ */
+void neigh_seen(int n);
+
+/* Initializes the neighbor module.
+ * Returns 0 on success, otherwise a negative error code.
+ */
+int neigh_init(void);
+
 /* Clean the neighbor slot by using the ID.
  * Returns 0 on success, otherwise a negative error code.
  */
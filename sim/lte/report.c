@@ -0,0 +1,123 @@
+/* Copyright (c) 2017 Kewin Rausch
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Empower Agent simulator report batching module.
+ */
+
+#include <time.h>
+
+#include "emsim.h"
+
+#define LOG_REP(x, ...)		LOG_TRACE(x, ##__VA_ARGS__)
+
+/* Dif "b-a" two timespec structs and return such value in ms.*/
+#define ts_diff_to_ms(a, b) 			\
+	(((b.tv_sec - a.tv_sec) * 1000) +	\
+	 ((b.tv_nsec - a.tv_nsec) / 1000000))
+
+/******************************************************************************
+ * Globals used all around the simulator:                                     *
+ ******************************************************************************/
+
+em_rep sim_rep = {
+	.hold     = 0,
+	.nof_msg  = 0,
+	.nof_send = 0,
+};
+
+/* Messages waiting to be sent. */
+char            rep_buf[REP_BUF_SIZE];
+/* Bytes used in the batch. */
+unsigned int    rep_len = 0;
+/* When the oldest message of the batch has been added. */
+struct timespec rep_first;
+
+/******************************************************************************
+ * Public accessible procedures:                                              *
+ ******************************************************************************/
+
+char * rep_get(unsigned int * size)
+{
+	if(REP_BUF_SIZE - rep_len < REP_MSG_MAX) {
+		rep_flush();
+	}
+
+	*size = REP_BUF_SIZE - rep_len;
+
+	return rep_buf + rep_len;
+}
+
+void rep_put(int len)
+{
+	if(len <= 0) {
+		return;
+	}
+
+	if(rep_len == 0) {
+		clock_gettime(CLOCK_MONOTONIC, &rep_first);
+	}
+
+	rep_len += (unsigned int)len;
+	sim_rep.nof_msg++;
+}
+
+int rep_flush(void)
+{
+	int ret;
+
+	if(rep_len == 0) {
+		return SUCCESS;
+	}
+
+	ret = em_send(sim_ID, rep_buf, rep_len);
+
+	if(ret < 0) {
+		LOG_REP("Failed to send %u bytes of reports\n", rep_len);
+	}
+
+	/* Reports are a snapshot; new ones will follow, do not retry. */
+	rep_len = 0;
+	sim_rep.nof_send++;
+
+	return ret < 0 ? ret : SUCCESS;
+}
+
+/******************************************************************************
+ * Report simulation logic:                                                   *
+ ******************************************************************************/
+
+u32 rep_compute(void)
+{
+	struct timespec now;
+
+	if(rep_len == 0) {
+		return SUCCESS;
+	}
+
+	/* Nobody to send to; what is in there is already stale. */
+	if(!em_is_connected(sim_ID)) {
+		rep_len = 0;
+		return SUCCESS;
+	}
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+
+	if(ts_diff_to_ms(rep_first, now) < sim_rep.hold) {
+		return SUCCESS;
+	}
+
+	return rep_flush();
+}
@@ -0,0 +1,82 @@
+/* Copyright (c) 2017 Kewin Rausch
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Empower Agent simulator report batching module.
+ *
+ * Periodic reports (UE list, UE measurements, MAC) are formatted one after
+ * the other in a single buffer and handed to the agent with one send, rather
+ * than one send per message. Every report still is a complete protocol
+ * message bound to its own trigger, so the controller sees the same messages
+ * as before, only coalesced on the connection.
+ *
+ * The batch is flushed when it cannot hold another message, and at the end
+ * of a simulation step once the oldest message has been held for 'hold' ms.
+ */
+
+#ifndef __EM_SIM_REPORT_H
+#define __EM_SIM_REPORT_H
+
+#include <emtypes.h>
+
+/* Size of the batch buffer. */
+#define REP_BUF_SIZE			16384
+/* Space which must be free to format one more message. */
+#define REP_MSG_MAX			2048
+
+/* Describes the state of the report batching. */
+typedef struct __em_sim_report {
+	/* Maximum time a report is held before being sent, in ms. */
+	u32 hold;
+
+	/* Reports given to the batch. */
+	u64 nof_msg;
+	/* Sends to the agent performed. */
+	u64 nof_send;
+} em_rep;
+
+/******************************************************************************
+ * Globals used all around the simulator:                                     *
+ ******************************************************************************/
+
+/* Report batching state. */
+extern em_rep sim_rep;
+
+/******************************************************************************
+ * Public accessible procedures:                                              *
+ ******************************************************************************/
+
+/* Returns the area of the batch where the next message shall be formatted,
+ * flushing the batch first if it has not enough room left. The space
+ * available, at least REP_MSG_MAX bytes, is stored in 'size'.
+ */
+char * rep_get(unsigned int * size);
+
+/* Adds to the batch the message of 'len' bytes just formatted in the area
+ * returned by rep_get; lengths lower or equal to 0 are ignored.
+ */
+void rep_put(int len);
+
+/* Sends the messages in the batch to the controller.
+ * Returns 0 on success, otherwise a negative error code.
+ */
+int rep_flush(void);
+
+/* Flushes the batch if its oldest message has been held long enough.
+ * Returns 0 on success, otherwise a negative error code.
+ */
+u32 rep_compute(void);
+
+#endif /* __EM_SIM_REPORT_H */
@@ -26,13 +26,37 @@
 
 #define LOG_SCE(x, ...) 	LOG_TRACE(x, ##__VA_ARGS__)
 
+/* Is a scenario field missing or left empty? */
+static int sce_blank(char * t)
+{
+	if(!t) {
+		return 1;
+	}
+
+	while(*t == ' ' || *t == '\t' || *t == '\r' || *t == '\n') {
+		t++;
+	}
+
+	return *t == '\0';
+}
+
 /* Parse a single line and apply effects in the simulator
  *
  * Current grammar supported is really easy, and the cases are:
  *      UE, rnti, imsi, plmn, pci, rsrp, rsrq
- *      NEIGH, id, IPv4, port
+ *      NEIGH, id, IPv4, port[, x, y[, earfcn]]
  *      CELL, id, dl_earfcn, ul_earfcn, dl_prb, ul_prb
  *      THIS, id, ctrl_addr, ctrl_port, x2 port
+ *      POS, x, y
+ *      MOBILITY, model, width, height, min_speed, max_speed
+ *      EVENT, rnti, type, quantity, thr1, thr2, hyst, ttt
+ *      BANDS, rnti, band[, band ...]
+ *
+ * The position and the EARFCN of a NEIGH are independent: leave x and y
+ * empty, as in "NEIGH, id, IPv4, port, , , earfcn", to give only the latter.
+ *
+ * An EVENT or BANDS with rnti 0 applies to every UE, otherwise only to that
+ * UE; UEs always support the band of their cell.
  */
 int sce_parse_line(char * line, int size)
 {
@@ -52,6 +76,10 @@ int sce_parse_line(char * line, int size)
 	//u64    v3;
 
 	int    r;
+	int    i;
+
+	em_ev  ev;
+	u64    bands[UE_BAND_WORDS];
 
 	/* Travel across string tokens */
 	word = strtok_r(line, ",", &curr);
@@ -81,25 +109,11 @@ int sce_parse_line(char * line, int size)
 
 		/* If successful then apply the right signal power */
 		if(r >= 0) {
-			sim_ues[r].meas[0].rs.rsrp = (sp)atof(t5);
-
-			if(sim_ues[r].meas[0].rs.rsrp > PHY_RSRP_HIGHER) {
-				sim_ues[r].meas[0].rs.rsrp = PHY_RSRP_HIGHER;
-			}
-
-			if(sim_ues[r].meas[0].rs.rsrp < PHY_RSRP_LOWER) {
-				sim_ues[r].meas[0].rs.rsrp = PHY_RSRP_LOWER;
-			}
-
-			sim_ues[r].meas[0].rs.rsrq = (sp)atof(t6);
-
-			if(sim_ues[r].meas[0].rs.rsrq > PHY_RSRQ_HIGHER) {
-				sim_ues[r].meas[0].rs.rsrq = PHY_RSRQ_HIGHER;
-			}
-
-			if(sim_ues[r].meas[0].rs.rsrq < PHY_RSRQ_LOWER) {
-				sim_ues[r].meas[0].rs.rsrq = PHY_RSRQ_LOWER;
-			}
+			/* Levels are kept in the range simulated. */
+			sim_ues[r].meas[0].rs.rsrp = phy_rsrp_step(
+				phy_rsrp_to_range((sp)atof(t5)), 0);
+			sim_ues[r].meas[0].rs.rsrq = phy_rsrq_step(
+				phy_rsrq_to_range((sp)atof(t6)), 0);
 		}
 	}
 	/* NEIGH case */
@@ -108,11 +122,35 @@ int sce_parse_line(char * line, int size)
 		t2 = strtok_r(curr, ",", &curr);
 		t3 = strtok_r(curr, ",", &curr);
 
+		/* Optional fields can be left empty, so do not merge them */
+		t4 = strsep(&curr, ",");
+		t5 = strsep(&curr, ",");
+		t6 = strsep(&curr, ",");
+
 		if(!t1 || !t2 || !t3) {
 			return ERR_SCE_PARSE_GRAM;
 		}
 
-		neigh_add_ipv4(atoi(t1), 0, t2, atoi(t3));
+		/* Remove meaningless white spaces that mess around */
+		while(*t2 == ' ') {
+			t2++;
+		}
+
+		r = neigh_add_ipv4(atoi(t1), 0, t2, atoi(t3));
+
+		/* Optional position of the neighbor cell */
+		if(r >= 0 && !sce_blank(t4) && !sce_blank(t5)) {
+			sim_neighs[r]->x       = (sp)atof(t4);
+			sim_neighs[r]->y       = (sp)atof(t5);
+			sim_neighs[r]->located = 1;
+		}
+
+		/* Optional frequency of the neighbor cell */
+		if(r >= 0 && !sce_blank(t6)) {
+			sim_neighs[r]->earfcn  = (u32)atoi(t6);
+			sim_neighs[r]->band    =
+				phy_earfcn_to_band(sim_neighs[r]->earfcn);
+		}
 	}
 	/* CELL case */
 	else if(strcmp(word, "CELL") == 0) {
@@ -157,6 +195,100 @@ int sce_parse_line(char * line, int size)
 		sim_x2_port   = (u16)atoi(t4);
 	}
 
+	/* POS case */
+	else if(strcmp(word, "POS") == 0) {
+		t1 = strtok_r(curr, ",", &curr);
+		t2 = strtok_r(curr, ",", &curr);
+
+		if(!t1 || !t2) {
+			return ERR_SCE_PARSE_GRAM;
+		}
+
+		sim_mob.x = (sp)atof(t1);
+		sim_mob.y = (sp)atof(t2);
+	}
+	/* MOBILITY case */
+	else if(strcmp(word, "MOBILITY") == 0) {
+		t1 = strtok_r(curr, ", \n", &curr);
+		t2 = strtok_r(curr, ",", &curr);
+		t3 = strtok_r(curr, ",", &curr);
+		t4 = strtok_r(curr, ",", &curr);
+		t5 = strtok_r(curr, ",", &curr);
+
+		if(!t1 || !t2 || !t3 || !t4 || !t5) {
+			return ERR_SCE_PARSE_GRAM;
+		}
+
+		r = mob_model_from_string(t1);
+
+		if(r < 0) {
+			return ERR_SCE_PARSE_GRAM;
+		}
+
+		sim_mob.model     = (u32)r;
+		sim_mob.area_w    = (sp)atof(t2);
+		sim_mob.area_h    = (sp)atof(t3);
+		sim_mob.speed_min = (sp)atof(t4);
+		sim_mob.speed_max = (sp)atof(t5);
+	}
+
+	/* EVENT case */
+	else if(strcmp(word, "EVENT") == 0) {
+		t1 = strtok_r(curr, ",", &curr);
+
+		if(!t1 || ev_parse(curr, ", \n", &ev)) {
+			return ERR_SCE_PARSE_GRAM;
+		}
+
+		r = atoi(t1);
+
+		if(r == UE_RNTI_INVALID) {
+			sim_ev = ev;
+		}
+
+		for(i = 0; i < UE_MAX; i++) {
+			if(sim_ues[i].rnti == UE_RNTI_INVALID ||
+				(r != UE_RNTI_INVALID && sim_ues[i].rnti != r)) {
+
+				continue;
+			}
+
+			sim_ues[i].ev         = ev;
+			sim_ues[i].meas[0].ev = ev;
+		}
+	}
+	/* BANDS case */
+	else if(strcmp(word, "BANDS") == 0) {
+		t1 = strtok_r(curr, ",", &curr);
+
+		if(!t1 || ue_bands_parse(curr, ", \n", bands) < 0) {
+			return ERR_SCE_PARSE_GRAM;
+		}
+
+		r = atoi(t1);
+
+		if(r == UE_RNTI_INVALID) {
+			memcpy(sim_ue_bands, bands, sizeof(bands));
+		}
+
+		for(i = 0; i < UE_MAX; i++) {
+			if(sim_ues[i].rnti == UE_RNTI_INVALID ||
+				(r != UE_RNTI_INVALID && sim_ues[i].rnti != r)) {
+
+				continue;
+			}
+
+			memcpy(sim_ues[i].bands, bands, sizeof(bands));
+
+			/* Band of the cell stays. */
+			v2 = phy_earfcn_to_band(sim_ues[i].meas[0].earfcn);
+
+			if(v2 != PHY_BAND_INVALID && v2 < UE_BAND_MAX) {
+				sim_ues[i].bands[v2 / 64] |= 1ULL << (v2 % 64);
+			}
+		}
+	}
+
 	return SUCCESS;
 }
 
@@ -205,6 +337,42 @@ int sce_load(char * path)
 	return ret;
 }
 
+/* Save the event of an UE, or of all of them if rnti is not valid */
+void sce_save_event(FILE * fd, u16 rnti, em_ev * ev)
+{
+	char buf[256];
+	int  bs;
+
+	bs = sprintf(buf, "EVENT, %d, %s, %s, %f, %f, %f, %u\n",
+		rnti,
+		ev_type_to_string(ev->type),
+		ev_quantity_to_string(ev->quantity),
+		ev->thr1,
+		ev->thr2,
+		ev->hyst,
+		ev->ttt);
+
+	fwrite(buf, 1, bs, fd);
+}
+
+/* Save a BANDS line for the given RNTI, if there are bands to save. */
+void sce_save_bands(FILE * fd, u16 rnti, u64 * bands)
+{
+	char buf[512];
+	int  bs;
+
+	bs = sprintf(buf, "BANDS, %d, ", rnti);
+
+	if(ue_bands_format(bands, ", ", buf + bs, sizeof(buf) - bs - 1) <= 0) {
+		return;
+	}
+
+	bs += strlen(buf + bs);
+	buf[bs++] = '\n';
+
+	fwrite(buf, 1, bs, fd);
+}
+
 /* Save a scenario file */
 int sce_save(char * path)
 {
@@ -229,6 +397,23 @@ int sce_save(char * path)
 
 	fwrite(buf, 1, bs, fd);
 
+	/* Position and mobility */
+	bs = sprintf(buf, "POS, %f, %f\n", sim_mob.x, sim_mob.y);
+
+	fwrite(buf, 1, bs, fd);
+
+	bs = sprintf(buf, "MOBILITY, %s, %f, %f, %f, %f\n",
+		mob_model_to_string(sim_mob.model),
+		sim_mob.area_w,
+		sim_mob.area_h,
+		sim_mob.speed_min,
+		sim_mob.speed_max);
+
+	fwrite(buf, 1, bs, fd);
+
+	/* Event given to every UE */
+	sce_save_event(fd, UE_RNTI_INVALID, &sim_ev);
+
 	/* This eNB cells */
 	for(i = 0; i < PHY_CELL_MAX; i++) {
 		if(sim_phy.cells[i].pci != PHY_PCI_INVALID) {
@@ -251,23 +436,58 @@ int sce_save(char * path)
 				sim_ues[i].imsi,
 				sim_ues[i].plmn,
 				sim_ues[i].pci,
-				sim_ues[i].meas[0].rs.rsrp,
-				sim_ues[i].meas[0].rs.rsrq);
+				phy_rsrp_from_range(sim_ues[i].meas[0].rs.rsrp),
+				phy_rsrq_from_range(sim_ues[i].meas[0].rs.rsrq));
 
 			fwrite(buf, 1, bs, fd);
 		}
 	}
 
+	/* UEs with their own event */
+	for(i = 0; i < UE_MAX; i++) {
+		if(sim_ues[i].rnti != UE_RNTI_INVALID &&
+			memcmp(&sim_ues[i].ev, &sim_ev, sizeof(em_ev))) {
+
+			sce_save_event(fd, sim_ues[i].rnti, &sim_ues[i].ev);
+		}
+	}
+
+	/* Bands of the UEs */
+	sce_save_bands(fd, UE_RNTI_INVALID, sim_ue_bands);
+
+	for(i = 0; i < UE_MAX; i++) {
+		if(sim_ues[i].rnti != UE_RNTI_INVALID) {
+			sce_save_bands(fd, sim_ues[i].rnti, sim_ues[i].bands);
+		}
+	}
+
 	/* Neighbor eNBs*/
-	for(i = 0; i < NEIGH_MAX; i++) {
-		if(sim_neighs[i].id != NEIGH_INVALID_ID) {
-			bs = sprintf(buf, "NEIGH, %d, %s, %d\n",
-				sim_neighs[i].id,
-				sim_neighs[i].ipv4,
-				ntohs(sim_neighs[i].saddr.sin_port));
+	for(i = 0; i < sim_neigh_cap; i++) {
+		if(sim_neighs[i]->id == NEIGH_INVALID_ID) {
+			continue;
+		}
 
-			fwrite(buf, 1, bs, fd);
+		bs = sprintf(buf, "NEIGH, %d, %s, %d",
+			sim_neighs[i]->id,
+			sim_neighs[i]->ipv4,
+			ntohs(sim_neighs[i]->saddr.sin_port));
+
+		/* Position and frequency are saved independently */
+		if(sim_neighs[i]->located) {
+			bs += sprintf(buf + bs, ", %f, %f",
+				sim_neighs[i]->x,
+				sim_neighs[i]->y);
+		} else if(sim_neighs[i]->earfcn) {
+			bs += sprintf(buf + bs, ", , ");
 		}
+
+		if(sim_neighs[i]->earfcn) {
+			bs += sprintf(buf + bs, ", %u", sim_neighs[i]->earfcn);
+		}
+
+		bs += sprintf(buf + bs, "\n");
+
+		fwrite(buf, 1, bs, fd);
 	}
 
 	LOG_SCE("Scenario saved in %s\n", path);
@@ -24,6 +24,8 @@
 
 #include <emtypes.h>
 
+#include "timer.h"
+
 /* 3 kinds of Primary Sync. sequence for 168 of Secondary Sync. sequences. */
 #define PHY_PCI_MAX                     503
 #define PHY_PCI_INVALID                 0xffff
@@ -34,6 +36,13 @@
 #define PHY_RSRQ_LOWER                 -20.0
 #define PHY_RSRQ_HIGHER                -3.0
 
+/* Band of EARFCNs out of the known ones. */
+#define PHY_BAND_INVALID               0
+
+/* Highest report ranges of RSRP and RSRQ. */
+#define PHY_RSRP_RANGE_MAX             97
+#define PHY_RSRQ_RANGE_MAX             34
+
 #define PHY_6PRBS_BW                    1.4f
 #define PHY_15PRBS_BW                   3.0f
 #define PHY_25PRBS_BW                   5.0f
@@ -57,14 +66,69 @@
  * MAC-related data structures:
  */
 
-/* Provides a description for the Reference Signal */
+/* Provides a description for the Reference Signal; levels are kept as the
+ * report ranges of 3GPP TS 36.133: RSRP_00 ... RSRP_97 in steps of 1 dB from
+ * -140 dBm, and RSRQ_00 ... RSRQ_34 in steps of 0.5 dB from -19.5 dB.
+ */
 typedef struct __em_sim_phy_ref_signal {
-	/* Reference Signal Received Power. */
-	sp rsrp;
-	/* Reference Signal Received Quality. */
-	sp rsrq;
+	/* Reference Signal Received Power, as report range. */
+	u8 rsrp;
+	/* Reference Signal Received Quality, as report range. */
+	u8 rsrq;
 } em_phy_rs;
 
+/* Translate a RSRP, in dBm, in its report range. */
+static inline u8 phy_rsrp_to_range(sp dbm)
+{
+	sp r = dbm + 141.0f;
+
+	return r <= 0.0f ? 0 :
+		(r >= PHY_RSRP_RANGE_MAX ? PHY_RSRP_RANGE_MAX : (u8)r);
+}
+
+/* Translate a RSRP report range in dBm; the lower bound of the range. */
+static inline sp phy_rsrp_from_range(u8 r)
+{
+	return (sp)r - 141.0f;
+}
+
+/* Translate a RSRQ, in dB, in its report range. */
+static inline u8 phy_rsrq_to_range(sp db)
+{
+	sp r = (db + 20.0f) * 2.0f;
+
+	return r <= 0.0f ? 0 :
+		(r >= PHY_RSRQ_RANGE_MAX ? PHY_RSRQ_RANGE_MAX : (u8)r);
+}
+
+/* Translate a RSRQ report range in dB; the lower bound of the range. */
+static inline sp phy_rsrq_from_range(u8 r)
+{
+	return (sp)r / 2.0f - 20.0f;
+}
+
+/* Moves a RSRP report range of 'n' steps, within the levels simulated. */
+static inline u8 phy_rsrp_step(u8 r, int n)
+{
+	int l = phy_rsrp_to_range(PHY_RSRP_LOWER);
+	int h = phy_rsrp_to_range(PHY_RSRP_HIGHER);
+
+	n += r;
+
+	return (u8)(n < l ? l : (n > h ? h : n));
+}
+
+/* Moves a RSRQ report range of 'n' steps, within the levels simulated. */
+static inline u8 phy_rsrq_step(u8 r, int n)
+{
+	int l = phy_rsrq_to_range(PHY_RSRQ_LOWER);
+	int h = phy_rsrq_to_range(PHY_RSRQ_HIGHER);
+
+	n += r;
+
+	return (u8)(n < l ? l : (n > h ? h : n));
+}
+
 /* Provides the description of a single cell at PHY layer. */
 typedef struct __em_sim_phy_cell {
 	/* Changes occurred in the cell? */
@@ -125,13 +189,13 @@ typedef struct __em_sim_mac_report {
 	/* Interval for the statistics in ms */
 	u32 interval;
 
-	/* Accumulator for the Downlink */
-	u32 DL_acc;
-	/* Accumulator for the Uplink*/
-	u32 UL_acc;
+	/* Value of the Downlink accumulator when the report started */
+	u32 DL_base;
+	/* Value of the Uplink accumulator when the report started */
+	u32 UL_base;
 
-	/* Last time the interval has been triggered */
-	struct timespec last;
+	/* Timer which sends the report */
+	em_timer tmr;
 } em_mac_rep;
 
 /* Organization of the DL in the MAC */
@@ -189,6 +253,11 @@ typedef struct __em_sim_mac {
 	/* Flag which identifies if RAN sharing is enabled or not */
 	int ran;
 
+	/* PRBs used in Downlink since the start */
+	u32        DL_acc;
+	/* PRBs used in Uplink since the start */
+	u32        UL_acc;
+
 	/* Active reports on the MAC layer */
 	em_mac_rep mac_rep[MAC_REPORT_MAX];
 } em_mac;
@@ -251,6 +320,11 @@ extern em_ran sim_ran;
  * Procedures:                                                                *
  ******************************************************************************/
 
+/* Look for the E-UTRA operating band of a downlink EARFCN.
+ * Returns the band number, or PHY_BAND_INVALID if not known.
+ */
+u32 phy_earfcn_to_band(u32 earfcn);
+
 /* Configures a new cell into the eNB.
  *
  * returns 0 on success, otherwise a negative error code.
@@ -269,6 +343,9 @@ u32 stack_compute();
  */
 u32 stack_init();
 
+/* Starts sending MAC report 'rep' every its interval. */
+void mac_rep_schedule(int rep);
+
 /*
  * RAN Sharing procedures:
  */
@@ -91,15 +91,10 @@ assign:
 	/* Assume using all the resources of this sub-frame */
 	mac->DL.prb_in_use += mac->DL.prb_max;
 
-	/* Update the accumulators of active reports */
-	for(i = 0; i < MAC_REPORT_MAX; i++) {
-		if(!mac->mac_rep[i].mod) {
-			continue;
-		}
-
-		/* PRB used must be casted per sub-frame */
-		mac->mac_rep[i].DL_acc += (mac->DL.prb_in_use * sim_loop_int);
-	}
+	/* Update the accumulator of the reports; PRB used must be casted per
+	 * sub-frame.
+	 */
+	mac->DL_acc += (mac->DL.prb_in_use * sim_loop_int);
 
 	return SUCCESS;
 }
@@ -244,15 +239,10 @@ int mac_fps_DL_schedule(em_mac * mac, em_ue * ues, u32 nof_ues)
 		mac->DL.prb_in_use = prbu;
 	}
 
-	/* Update the amount of PRBS used overall */
-	for(i = 0; i < MAC_REPORT_MAX; i++) {
-		if(!mac->mac_rep[i].mod) {
-			continue;
-		}
-
-		/* PRB used must be casted per sub-frame */
-		mac->mac_rep[i].DL_acc += (prbu * sim_loop_int);
-	}
+	/* Update the amount of PRBS used overall; PRB used must be casted per
+	 * sub-frame.
+	 */
+	mac->DL_acc += (prbu * sim_loop_int);
 
 	return SUCCESS;
 }
@@ -286,6 +276,57 @@ u32 mac_ul_compute()
 	return SUCCESS;
 }
 
+/* Sends a MAC report and waits for its next interval. */
+void mac_rep_timeout(em_timer * t)
+{
+	em_mac_rep *  r = tmr_entry(t, em_mac_rep, tmr);
+
+	int           mlen;
+	char *        buf;
+	unsigned int  size;
+
+	ep_macrep_det mac;
+
+	if(!r->mod) {
+		return;
+	}
+
+	mac.DL_prbs_used  = sim_mac.DL_acc - r->DL_base;
+	mac.DL_prbs_total = sim_mac.DL.prb_max;
+
+	mac.UL_prbs_used  = sim_mac.UL_acc - r->UL_base;
+	mac.UL_prbs_total = sim_mac.UL.prb_max;
+
+	buf  = rep_get(&size);
+	mlen = epf_trigger_macrep_rep(
+		buf,
+		size,
+		sim_ID,
+		sim_phy.cells[0].pci,
+		r->mod,
+		&mac);
+
+	rep_put(mlen);
+
+	tmr_arm(t, r->interval ? r->interval : sim_loop_int);
+}
+
+/******************************************************************************
+ * Public accessible procedures:                                              *
+ ******************************************************************************/
+
+void mac_rep_schedule(int rep)
+{
+	em_mac_rep * r = &sim_mac.mac_rep[rep];
+
+	/* Not initialized yet. */
+	if(!r->tmr.cb) {
+		tmr_init(&r->tmr, mac_rep_timeout, 0);
+	}
+
+	tmr_arm(&r->tmr, r->interval ? r->interval : sim_loop_int);
+}
+
 /******************************************************************************
  * MAC simulation logic:                                                      *
  ******************************************************************************/
@@ -304,10 +345,6 @@ u32 mac_init()
 		}
 	}
 
-	for(i = 0; i < MAC_REPORT_MAX; i++) {
-		clock_gettime(CLOCK_REALTIME, &sim_mac.mac_rep[i].last);
-	}
-
 	/* 1 second of speed for schedulers */
 	sim_mac.stu = 1000;
 
@@ -319,15 +356,7 @@ u32 mac_init()
 
 u32 mac_compute()
 {
-	int             i;
-	int             ret;
-
-	struct timespec now;
-
-	int             mlen;
-	char            buf[MEDIUM_BUF];
-
-	ep_macrep_det   mac;
+	int ret;
 
 	sim_mac.DL.tti = (sim_mac.DL.tti + 1) % 10240;
 
@@ -343,40 +372,7 @@ u32 mac_compute()
 		return ret;
 	}
 
-	clock_gettime(CLOCK_REALTIME, &now);
-
-	for(i = 0; i < MAC_REPORT_MAX; i++) {
-		/* Do not consider invalid reports */
-		if(!sim_mac.mac_rep[i].mod) {
-			continue;
-		}
-
-		if(ts_diff_to_ms(sim_mac.mac_rep[i].last, now) >=
-			sim_mac.mac_rep[i].interval) {
-
-			mac.DL_prbs_used  = sim_mac.mac_rep[i].DL_acc;
-			mac.DL_prbs_total = sim_mac.DL.prb_max;
-
-			mac.UL_prbs_used  = sim_mac.mac_rep[i].UL_acc;
-			mac.UL_prbs_total = sim_mac.UL.prb_max;
-
-			mlen = epf_trigger_macrep_rep(
-				buf,
-				MEDIUM_BUF,
-				sim_ID,
-				sim_phy.cells[0].pci,
-				sim_mac.mac_rep[i].mod,
-				&mac);
-
-			em_send(sim_ID, buf, mlen);
-
-			/* Reset the state of this report */
-			sim_mac.mac_rep[i].last.tv_nsec = now.tv_nsec;
-			sim_mac.mac_rep[i].last.tv_sec  = now.tv_sec;
-			//sim_mac.mac_rep[i].DL_acc       = 0;
-			//sim_mac.mac_rep[i].UL_acc       = 0;
-		}
-	}
+	/* Reports are sent by their own timers. */
 
 	return SUCCESS;
 }
@@ -0,0 +1,230 @@
+/* Copyright (c) 2017 Kewin Rausch
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Empower Agent simulator timer module.
+ */
+
+#include <time.h>
+
+#include "emsim.h"
+
+#define TMR_MASK		(TMR_SLOTS - 1)
+
+/* Slots of the wheel; each one is the head of a circular list of timers. */
+em_timer        tmr_wheel[TMR_LEVELS][TMR_SLOTS];
+/* Has the wheel been set up? */
+int             tmr_ready   = 0;
+
+/* Next ms which the wheel will process. */
+u64             tmr_jiffies = 0;
+/* Is the wheel calling the procedures of expired timers? */
+int             tmr_running = 0;
+
+/* Origin of the wheel clock. */
+struct timespec tmr_t0;
+
+/******************************************************************************
+ * Private procedures for timer module only:                                  *
+ ******************************************************************************/
+
+void tmr_setup(void)
+{
+	int l;
+	int s;
+
+	for(l = 0; l < TMR_LEVELS; l++) {
+		for(s = 0; s < TMR_SLOTS; s++) {
+			tmr_wheel[l][s].next = &tmr_wheel[l][s];
+			tmr_wheel[l][s].prev = &tmr_wheel[l][s];
+		}
+	}
+
+	clock_gettime(CLOCK_MONOTONIC, &tmr_t0);
+
+	tmr_ready = 1;
+}
+
+/* Puts the timer in the slot matching its expiration. */
+void tmr_insert(em_timer * t)
+{
+	int        l;
+	u64        d = t->expire - tmr_jiffies;
+	u64        e = t->expire;
+	em_timer * h;
+
+	/* Too far; park it on the last level, it will be placed again. */
+	if(d > TMR_DELAY_MAX) {
+		d = TMR_DELAY_MAX;
+		e = tmr_jiffies + TMR_DELAY_MAX;
+	}
+
+	for(l = 0; l < TMR_LEVELS - 1; l++) {
+		if(d < (1ULL << ((l + 1) * TMR_BITS))) {
+			break;
+		}
+	}
+
+	h = &tmr_wheel[l][(e >> (l * TMR_BITS)) & TMR_MASK];
+
+	t->next       = h;
+	t->prev       = h->prev;
+	h->prev->next = t;
+	h->prev       = t;
+}
+
+/* Moves the timers of a slot of an upper level to the lower ones. */
+void tmr_cascade(int l, int s)
+{
+	em_timer * h = &tmr_wheel[l][s];
+	em_timer * t = h->next;
+	em_timer * n;
+
+	h->next = h;
+	h->prev = h;
+
+	for(; t != h; t = n) {
+		n = t->next;
+		tmr_insert(t);
+	}
+}
+
+/* Calls the procedures of the timers in a slot of the first level. */
+void tmr_expire(int s)
+{
+	em_timer   l;
+	em_timer * h = &tmr_wheel[0][s];
+	em_timer * t;
+
+	if(h->next == h) {
+		return;
+	}
+
+	/* Detach the list, since procedures can arm timers again. */
+	l.next       = h->next;
+	l.prev       = h->prev;
+	l.next->prev = &l;
+	l.prev->next = &l;
+	h->next      = h;
+	h->prev      = h;
+
+	while(l.next != &l) {
+		t = l.next;
+
+		l.next        = t->next;
+		t->next->prev = &l;
+		t->next       = 0;
+		t->prev       = 0;
+
+		t->cb(t);
+	}
+}
+
+/******************************************************************************
+ * Public accessible procedures:                                              *
+ ******************************************************************************/
+
+void tmr_init(em_timer * t, tmr_cb cb, void * arg)
+{
+	t->next   = 0;
+	t->prev   = 0;
+	t->expire = 0;
+	t->cb     = cb;
+	t->arg    = arg;
+}
+
+void tmr_arm(em_timer * t, u32 ms)
+{
+	u64 now;
+
+	if(!tmr_ready) {
+		tmr_setup();
+	}
+
+	tmr_cancel(t);
+
+	/* Procedures run at the time of their expiration, so periodic timers
+	 * do not drift; out of them, the wheel can be behind the clock.
+	 */
+	now = tmr_running ? tmr_jiffies : tmr_now();
+
+	if(now < tmr_jiffies) {
+		now = tmr_jiffies;
+	}
+
+	/* The slot being processed will not be looked at again. */
+	t->expire = now + (ms ? ms : 1);
+
+	tmr_insert(t);
+}
+
+void tmr_cancel(em_timer * t)
+{
+	if(!t->prev) {
+		return;
+	}
+
+	t->prev->next = t->next;
+	t->next->prev = t->prev;
+	t->next       = 0;
+	t->prev       = 0;
+}
+
+u64 tmr_now(void)
+{
+	struct timespec n;
+
+	if(!tmr_ready) {
+		tmr_setup();
+	}
+
+	clock_gettime(CLOCK_MONOTONIC, &n);
+
+	return (u64)(n.tv_sec - tmr_t0.tv_sec) * 1000 +
+		(n.tv_nsec - tmr_t0.tv_nsec) / 1000000;
+}
+
+/******************************************************************************
+ * Timer simulation logic:                                                    *
+ ******************************************************************************/
+
+u32 tmr_compute(void)
+{
+	int l;
+	int s;
+	u64 now = tmr_now();
+
+	tmr_running = 1;
+
+	for(; tmr_jiffies <= now; tmr_jiffies++) {
+		/* Entering a new round of a level: bring down the timers which
+		 * expire in it.
+		 */
+		for(l = 1; l < TMR_LEVELS; l++) {
+			if((tmr_jiffies >> ((l - 1) * TMR_BITS)) & TMR_MASK) {
+				break;
+			}
+
+			s = (tmr_jiffies >> (l * TMR_BITS)) & TMR_MASK;
+			tmr_cascade(l, s);
+		}
+
+		tmr_expire(tmr_jiffies & TMR_MASK);
+	}
+
+	tmr_running = 0;
+
+	return SUCCESS;
+}
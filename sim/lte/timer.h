@@ -0,0 +1,98 @@
+/* Copyright (c) 2017 Kewin Rausch
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Empower Agent simulator timer module.
+ *
+ * Hierarchical timer wheel with a resolution of 1 ms. Timers are embedded in
+ * the objects they belong to, so arming and cancelling them never allocates
+ * memory, and both operations take constant time. Each step of the wheel
+ * costs only the timers which expire, plus the occasional cascade of a slot
+ * of the upper levels.
+ */
+
+#ifndef __EM_SIM_TIMER_H
+#define __EM_SIM_TIMER_H
+
+#include <stddef.h>
+
+#include <emtypes.h>
+
+/* Levels of the wheel. */
+#define TMR_LEVELS			4
+/* Bits of the time covered by each level. */
+#define TMR_BITS			6
+/* Slots per level. */
+#define TMR_SLOTS			(1 << TMR_BITS)
+
+/* Longest delay which can be armed, in ms (about 4.6 hours). */
+#define TMR_DELAY_MAX			((1 << (TMR_LEVELS * TMR_BITS)) - 1)
+
+/* Returns the object of type 'type' which embeds the timer 't' as 'member'. */
+#define tmr_entry(t, type, member)	\
+	((type *)((char *)(t) - offsetof(type, member)))
+
+typedef struct __em_sim_timer em_timer;
+
+/* Procedure called when a timer expires; the timer can be armed again. */
+typedef void (* tmr_cb)(em_timer * t);
+
+/* A timer, to embed in the object which needs it. */
+struct __em_sim_timer {
+	/* Links in the slot of the wheel. */
+	em_timer * next;
+	em_timer * prev;
+
+	/* When the timer expires, in ms of the wheel clock. */
+	u64        expire;
+
+	/* Procedure to call at expiration. */
+	tmr_cb     cb;
+	/* Opaque data for the procedure. */
+	void *     arg;
+};
+
+/******************************************************************************
+ * Public accessible procedures:                                              *
+ ******************************************************************************/
+
+/* Prepares a timer for the use; must be called before any other operation
+ * on it, and again only when it is not armed.
+ */
+void tmr_init(em_timer * t, tmr_cb cb, void * arg);
+
+/* Arms the timer to expire in 'ms' milliseconds; an armed timer is moved. */
+void tmr_arm(em_timer * t, u32 ms);
+
+/* Disarms the timer; nothing happens if it is not armed. */
+void tmr_cancel(em_timer * t);
+
+/* Is the timer armed? */
+static inline int tmr_armed(em_timer * t)
+{
+	return t->prev != 0;
+}
+
+/* Returns the current time of the wheel clock, in ms. */
+u64 tmr_now(void);
+
+/* Advances the wheel up to the current time, calling the procedures of the
+ * timers which expired.
+ *
+ * Returns 0 on success, otherwise a negative error code.
+ */
+u32 tmr_compute(void);
+
+#endif /* __EM_SIM_TIMER_H */
@@ -0,0 +1,345 @@
+/* Copyright (c) 2017 Kewin Rausch
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Empower Agent simulator mobility trace module.
+ */
+
+#include <endian.h>
+#include <fcntl.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "emsim.h"
+
+#define LOG_TRC(x, ...)		LOG_TRACE(x, ##__VA_ARGS__)
+
+/* Longest CSV line accepted. */
+#define TRC_LINE_MAX		128
+
+/* Consumed part of the file is given back to the system in chunks of this
+ * size, so the resident memory does not grow with the trace.
+ */
+#define TRC_RELEASE_CHUNK	(16 * 1024 * 1024)
+
+/* Dif "b-a" two timespec structs and return such value in ms.*/
+#define ts_diff_to_ms(a, b) 			\
+	(((b.tv_sec - a.tv_sec) * 1000) +	\
+	 ((b.tv_nsec - a.tv_nsec) / 1000000))
+
+/******************************************************************************
+ * Globals used all around the simulator:                                     *
+ ******************************************************************************/
+
+em_trc sim_trc = {
+	.active  = 0,
+	.timeout = TRC_TIMEOUT_DEFAULT,
+	.plmn    = 0x00101,
+};
+
+/* Mapped trace file. */
+char *          trc_map  = 0;
+/* Size of the mapped file. */
+size_t          trc_size = 0;
+/* Position of the next record to read. */
+size_t          trc_pos  = 0;
+/* Position up to which the file has been given back to the system. */
+size_t          trc_rel  = 0;
+/* Is the trace in binary format? */
+int             trc_bin  = 0;
+
+/* Next record, already read but not yet due. */
+struct trc_record trc_next;
+/* Is there a record in trc_next? */
+int             trc_pending = 0;
+
+/* Time of the first record of the trace. */
+u64             trc_t0;
+/* Moment the replay started. */
+struct timespec trc_start;
+
+/* Last time, in trace ms, each UE appeared in the trace. */
+u64             trc_seen[UE_MAX];
+/* RNTI of the UEs attached because of the trace; 0 if not attached by it. */
+u16             trc_rnti[UE_MAX];
+
+/******************************************************************************
+ * Private procedures for trace module only:                                  *
+ ******************************************************************************/
+
+/* Reads the next binary record.
+ * Returns 1 if a record has been read, 0 at the end of the trace.
+ */
+int trc_read_bin(struct trc_record * r)
+{
+	u32 f;
+
+	if(trc_pos + sizeof(struct trc_record) > trc_size) {
+		return 0;
+	}
+
+	memcpy(r, trc_map + trc_pos, sizeof(struct trc_record));
+	trc_pos += sizeof(struct trc_record);
+
+	r->ts   = le64toh(r->ts);
+	r->imsi = le64toh(r->imsi);
+
+	memcpy(&f, &r->x, sizeof(u32));
+	f = le32toh(f);
+	memcpy(&r->x, &f, sizeof(u32));
+
+	memcpy(&f, &r->y, sizeof(u32));
+	f = le32toh(f);
+	memcpy(&r->y, &f, sizeof(u32));
+
+	return 1;
+}
+
+/* Reads the next CSV record, skipping lines which are not records.
+ * Returns 1 if a record has been read, 0 at the end of the trace.
+ */
+int trc_read_csv(struct trc_record * r)
+{
+	char   line[TRC_LINE_MAX];
+	char * e;
+	size_t l;
+
+	while(trc_pos < trc_size) {
+		e = memchr(trc_map + trc_pos, '\n', trc_size - trc_pos);
+		l = e ? (size_t)(e - (trc_map + trc_pos)) : trc_size - trc_pos;
+
+		/* The mapping is read-only and not terminated; work on a copy */
+		if(l < TRC_LINE_MAX) {
+			memcpy(line, trc_map + trc_pos, l);
+			line[l] = 0;
+		}
+
+		trc_pos = e ? (size_t)(e - trc_map) + 1 : trc_size;
+
+		/* A cut line could still parse, into the wrong record */
+		if(l >= TRC_LINE_MAX) {
+			sim_trc.nof_err++;
+			continue;
+		}
+
+		if(line[0] < '0' || line[0] > '9') {
+			continue;
+		}
+
+		if(sscanf(line, "%"SCNu64",%"SCNu64",%f,%f",
+			&r->ts, &r->imsi, &r->x, &r->y) == 4) {
+
+			return 1;
+		}
+
+		sim_trc.nof_err++;
+	}
+
+	return 0;
+}
+
+/* Reads the next record of the trace, whatever its format. */
+static inline int trc_read(struct trc_record * r)
+{
+	return trc_bin ? trc_read_bin(r) : trc_read_csv(r);
+}
+
+/* Applies a record: moves the UE, attaching it first if necessary. */
+void trc_apply(struct trc_record * r)
+{
+	int u = ue_find_imsi(r->imsi);
+
+	if(u < 0) {
+		u = ue_add(
+			sim_phy.cells[0].pci,
+			sim_phy.cells[0].DL_earfcn,
+			UE_RNTI_INVALID,
+			sim_trc.plmn,
+			r->imsi,
+			1);
+
+		if(u < 0) {
+			sim_trc.nof_err++;
+			return;
+		}
+
+		trc_rnti[u] = sim_ues[u].rnti;
+	}
+
+	mob_set_pos(u, r->x, r->y);
+
+	trc_seen[u] = r->ts;
+	sim_trc.nof_rec++;
+}
+
+/******************************************************************************
+ * Public accessible procedures:                                              *
+ ******************************************************************************/
+
+int trc_open(char * path)
+{
+	int         fd;
+	struct stat st;
+
+	if(sim_trc.active) {
+		trc_close();
+	}
+
+	fd = open(path, O_RDONLY);
+
+	if(fd < 0) {
+		LOG_TRC("Cannot open trace %s\n", path);
+		return ERR_TRC_OPEN_IO;
+	}
+
+	if(fstat(fd, &st) || st.st_size == 0) {
+		LOG_TRC("Trace %s is empty or cannot be inspected\n", path);
+		close(fd);
+		return ERR_TRC_OPEN_IO;
+	}
+
+	trc_size = (size_t)st.st_size;
+	trc_map  = mmap(0, trc_size, PROT_READ, MAP_PRIVATE, fd, 0);
+
+	/* The mapping stays valid once the descriptor is closed. */
+	close(fd);
+
+	if(trc_map == MAP_FAILED) {
+		LOG_TRC("Cannot map trace %s\n", path);
+		trc_map = 0;
+		return ERR_TRC_OPEN_MAP;
+	}
+
+	/* Records are consumed in order; let the kernel read ahead. */
+	madvise(trc_map, trc_size, MADV_SEQUENTIAL);
+
+	trc_bin = trc_size >= TRC_MAGIC_LEN &&
+		memcmp(trc_map, TRC_MAGIC, TRC_MAGIC_LEN) == 0;
+	trc_pos = trc_bin ? TRC_MAGIC_LEN : 0;
+	trc_rel = 0;
+
+	memset(trc_rnti, 0, sizeof(trc_rnti));
+
+	trc_pending = trc_read(&trc_next);
+
+	if(!trc_pending) {
+		LOG_TRC("Trace %s has no records\n", path);
+		trc_close();
+		return ERR_TRC_OPEN_EMPTY;
+	}
+
+	trc_t0 = trc_next.ts;
+	clock_gettime(CLOCK_MONOTONIC, &trc_start);
+
+	sim_trc.active  = 1;
+	sim_trc.nof_rec = 0;
+	sim_trc.nof_err = 0;
+
+	/* UEs are now moved by the trace only. */
+	sim_mob.model   = MOB_MODEL_TRACE;
+
+	LOG_TRC("Replaying %s trace %s, %zu bytes\n",
+		trc_bin ? "binary" : "CSV", path, trc_size);
+
+	return SUCCESS;
+}
+
+void trc_close(void)
+{
+	if(trc_map) {
+		munmap(trc_map, trc_size);
+	}
+
+	trc_map        = 0;
+	trc_size       = 0;
+	trc_pos        = 0;
+	trc_pending    = 0;
+	sim_trc.active = 0;
+}
+
+/******************************************************************************
+ * Trace simulation logic:                                                    *
+ ******************************************************************************/
+
+u32 trc_compute(void)
+{
+	int             i;
+	int             n = 0;
+	u64             now;
+	size_t          r;
+	struct timespec ts;
+
+	if(!sim_trc.active) {
+		return SUCCESS;
+	}
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	now = trc_t0 + ts_diff_to_ms(trc_start, ts);
+
+	/* Apply every record which is due by now. */
+	while(trc_pending && trc_next.ts <= now) {
+		trc_apply(&trc_next);
+		trc_pending = trc_read(&trc_next);
+	}
+
+	/* Give back the pages already consumed. */
+	r = trc_pos & ~((size_t)TRC_RELEASE_CHUNK - 1);
+
+	if(trc_map && r > trc_rel) {
+		madvise(trc_map + trc_rel, r - trc_rel, MADV_DONTNEED);
+		trc_rel = r;
+	}
+
+	/* UEs which are not in the trace anymore leave the cell. */
+	for(i = 0; i < UE_MAX; i++) {
+		if(trc_rnti[i] == UE_RNTI_INVALID) {
+			continue;
+		}
+
+		/* Removed or replaced by someone else in the meantime. */
+		if(sim_ues[i].rnti != trc_rnti[i]) {
+			trc_rnti[i] = UE_RNTI_INVALID;
+			continue;
+		}
+
+		/* Records ahead of the replay clock are not late. */
+		if(now >= trc_seen[i] && now - trc_seen[i] >= sim_trc.timeout) {
+			LOG_TRC("UE %"PRIu64" left the trace\n",
+				sim_ues[i].imsi);
+
+			ue_rem(trc_rnti[i], 1);
+			trc_rnti[i] = UE_RNTI_INVALID;
+
+			continue;
+		}
+
+		n++;
+	}
+
+	/* Done once the last records have been applied and their UEs left. */
+	if(!trc_pending && n == 0) {
+		LOG_TRC("Trace ended; %"PRIu64" records, %"PRIu64" errors\n",
+			sim_trc.nof_rec, sim_trc.nof_err);
+
+		trc_close();
+	}
+
+	return SUCCESS;
+}
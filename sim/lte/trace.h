@@ -0,0 +1,100 @@
+/* Copyright (c) 2017 Kewin Rausch
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Empower Agent simulator mobility trace module.
+ *
+ * Replays recorded UE trajectories. A trace is a sequence of records, ordered
+ * by time, each one telling where an UE (identified by its IMSI) was at that
+ * moment. Two formats are accepted:
+ *
+ *      CSV:    one "timestamp_ms,imsi,x,y" record per line; lines which do
+ *              not start with a digit (headers, comments) are skipped.
+ *
+ *      Binary: the TRC_MAGIC header followed by packed little-endian
+ *              records of type struct trc_record.
+ *
+ * The file is memory-mapped and consumed a little at every step of the
+ * simulation, so traces of any size are never loaded in memory as a whole.
+ */
+
+#ifndef __EM_SIM_TRACE_H
+#define __EM_SIM_TRACE_H
+
+#include <emtypes.h>
+
+/* First bytes of a binary trace file. */
+#define TRC_MAGIC			"EMTRACE1"
+#define TRC_MAGIC_LEN			8
+
+/* Default time after which an UE not present in the trace leaves, in ms. */
+#define TRC_TIMEOUT_DEFAULT		5000
+
+/* Record of a binary trace file. */
+struct trc_record {
+	/* Time of the record, in ms. */
+	u64 ts;
+	/* UE International Mobile Subscriber Identity. */
+	u64 imsi;
+	/* Position of the UE, in meters. */
+	sp  x;
+	sp  y;
+}__attribute__((packed));
+
+/* Describes the trace being replayed. */
+typedef struct __em_sim_trace {
+	/* Is a trace being replayed? */
+	u32 active;
+
+	/* Time after which an UE missing from the trace leaves, in ms. */
+	u32 timeout;
+	/* PLMN given to the UEs which appear in the trace. */
+	u32 plmn;
+
+	/* Records applied so far. */
+	u64 nof_rec;
+	/* Records which could not be parsed or applied. */
+	u64 nof_err;
+} em_trc;
+
+/******************************************************************************
+ * Globals used all around the simulator:                                     *
+ ******************************************************************************/
+
+/* Trace replay state. */
+extern em_trc sim_trc;
+
+/******************************************************************************
+ * Public accessible procedures:                                              *
+ ******************************************************************************/
+
+/* Opens a trace file and prepares it for replay; UEs will be moved by the
+ * trace from now on.
+ *
+ * Returns 0 on success, otherwise a negative error code.
+ */
+int trc_open(char * path);
+
+/* Stops the replay and releases the trace file. */
+void trc_close(void);
+
+/* Applies the records of the trace which are due at this time, attaching the
+ * UEs which appear and detaching the ones which left.
+ *
+ * Returns 0 on success, otherwise a negative error code.
+ */
+u32 trc_compute(void);
+
+#endif /* __EM_SIM_TRACE_H */
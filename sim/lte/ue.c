@@ -18,13 +18,18 @@
  */
 
 #include <inttypes.h>
+#include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <time.h>
 
 #include "emsim.h"
 
 #define LOG_UE(x, ...)          LOG_TRACE(x, ##__VA_ARGS__)
 
+/* Max number of UEs carried by a UE report. */
+#define UE_REP_MAX		32
+
 /******************************************************************************
  * Globals used all around the simulator:                                     *
  ******************************************************************************/
@@ -38,56 +43,381 @@ em_ue sim_ues[UE_MAX] = {{0}};
 /* Identify if some modifications occurs on the UE list. */
 u32 sim_ue_dirty = 0;
 
+/* Minimum time between two reports of the UE list, in ms. */
+u32 sim_ue_rep_int = 0;
+
+/* Time before which the UE list is not reported again, in ms. */
+u64 ue_rep_next = 0;
+
+/* Index of the UE slots by RNTI. */
+em_hash ue_rnti_idx = {0};
+/* Index of the UE slots by IMSI. */
+em_hash ue_imsi_idx = {0};
+
+/* Assign RNTIs in a random order rather than sequentially? */
+u32 sim_rnti_rand = 0;
+
+/* Neighbors must be received above this RSRP to be reported. */
+sp  sim_meas_rsrp_min = PHY_RSRP_LOWER;
+
+/* Bands given to the new UEs, besides the one of their cell. */
+u64 sim_ue_bands[UE_BAND_WORDS] = {0};
+
+/* UEs with measurements to look at, linked by slot; -1 ends the list. Link
+ * fields live out of the UE descriptors, which are cleared on reuse.
+ */
+s32 ue_work_head = -1;
+s32 ue_work_tail = -1;
+s32 ue_work_next[UE_MAX];
+/* Is the UE in the list? */
+u8  ue_work_in[UE_MAX];
+/* Measurements of the UE to look at, one bit each. */
+u32 ue_work_mask[UE_MAX];
+
+/* Slots below this one are all in use; the search for a free one starts
+ * here, so that many UEs attached together do not rescan the table.
+ */
+u32 ue_free_hint = 0;
+
+/* Bitmap of the RNTIs in use; one bit for each possible 16 bits value. */
+u64 ue_rnti_map[UE_RNTI_MAP_WORDS] = {0};
+/* Position where the next RNTI search starts from. */
+u32 ue_rnti_cur  = 1;
+/* State of the private generator used for random RNTI assignment. */
+u32 ue_rnti_seed = 1;
+
 /******************************************************************************
- * Public accessible procedures:                                              *
+ * RNTI allocator:                                                            *
  ******************************************************************************/
 
-int ue_add(u16 pci, u32 earfcn, u16 rnti, u32 plmnid, u64 imsi, int rep)
+/* Xorshift generator; it keeps RNTI assignment off the global rand() state. */
+static inline u32 ue_rnti_random(void)
 {
-	int i;
-	int e;      /* Existing RNTI detected. */
-	int f = -1; /* Detected free UE slot. */
+	ue_rnti_seed ^= ue_rnti_seed << 13;
+	ue_rnti_seed ^= ue_rnti_seed >> 17;
+	ue_rnti_seed ^= ue_rnti_seed << 5;
+
+	return ue_rnti_seed;
+}
+
+u16 ue_rnti_alloc(void)
+{
+	u32 i;
+	u32 w;
+	u64 f;
+
+	if(sim_rnti_rand) {
+		ue_rnti_cur = ue_rnti_random() % UE_RNTI_RESERVED;
+	}
+
+	w = ue_rnti_cur >> 6;
+	/* Do not consider RNTIs which are before the cursor in its word. */
+	f = ~ue_rnti_map[w] & (~0ULL << (ue_rnti_cur & 63));
+
+	/* Visit every word once, plus the first one again for its head. */
+	for(i = 0; i <= UE_RNTI_MAP_WORDS; i++) {
+		if(f) {
+			w = (w << 6) + __builtin_ctzll(f);
+
+			ue_rnti_map[w >> 6] |= 1ULL << (w & 63);
+			ue_rnti_cur = (w + 1) % UE_RNTI_RESERVED;
+
+			return (u16)w;
+		}
+
+		w = (w + 1) % UE_RNTI_MAP_WORDS;
+		f = ~ue_rnti_map[w];
+	}
+
+	return UE_RNTI_INVALID;
+}
+
+int ue_rnti_take(u16 rnti)
+{
+	if(rnti == UE_RNTI_INVALID || rnti >= UE_RNTI_RESERVED) {
+		return ERR_UE_RNTI_INVALID;
+	}
+
+	if(ue_rnti_map[rnti >> 6] & (1ULL << (rnti & 63))) {
+		return ERR_UE_RNTI_IN_USE;
+	}
+
+	ue_rnti_map[rnti >> 6] |= 1ULL << (rnti & 63);
+
+	return SUCCESS;
+}
+
+void ue_rnti_free(u16 rnti)
+{
+	if(rnti == UE_RNTI_INVALID || rnti >= UE_RNTI_RESERVED) {
+		return;
+	}
+
+	ue_rnti_map[rnti >> 6] &= ~(1ULL << (rnti & 63));
+}
+
+/******************************************************************************
+ * UE reports:                                                                *
+ ******************************************************************************/
+
+/* Sends the whole list of the attached UEs, up to the number the report can
+ * carry.
+ *
+ * Returns 0 on success, otherwise a negative error code.
+ */
+int ue_rep_all(void)
+{
+	int           i;
+	int           nof_ues;
+	int           max;
+	int           mlen;
+	char *        buf;
+	unsigned int  size;
+	ep_ue_details ued[UE_REP_MAX];
+
+	max = sim_UE_rep_max < UE_REP_MAX ? sim_UE_rep_max : UE_REP_MAX;
+
+	for(i = 0, nof_ues = 0; i < UE_MAX; i++) {
+		if(sim_ues[i].rnti == UE_RNTI_INVALID) {
+			continue;
+		}
+
+		/* We have a limited amount of UEs to send */
+		if(nof_ues >= max) {
+			break;
+		}
+
+		ued[nof_ues].rnti = sim_ues[i].rnti;
+		ued[nof_ues].imsi = sim_ues[i].imsi;
+		ued[nof_ues].plmn = sim_ues[i].plmn;
+		ued[nof_ues].pci  = sim_ues[i].pci;
+
+		nof_ues++;
+	}
+
+	buf  = rep_get(&size);
+	mlen = epf_trigger_uerep_rep(
+		buf,
+		size,
+		sim_ID,
+		sim_phy.cells[0].pci,
+		sim_UE_rep_mod,
+		nof_ues,
+		sim_UE_rep_max,
+		ued);
+
+	if(mlen <= 0) {
+		LOG_UE("Cannot format the UE report!\n");
+		return -1;
+	}
+
+	rep_put(mlen);
+
+	return SUCCESS;
+}
+
+/******************************************************************************
+ * Measurement reports:                                                       *
+ ******************************************************************************/
+
+/* Queues measurement 'j' of UE 'i' to be looked at during the next step. */
+void ue_work_add(int i, int j)
+{
+	ue_work_mask[i] |= 1U << j;
+
+	if(ue_work_in[i]) {
+		return;
+	}
+
+	ue_work_in[i]   = 1;
+	ue_work_next[i] = -1;
+
+	if(ue_work_tail >= 0) {
+		ue_work_next[ue_work_tail] = i;
+	} else {
+		ue_work_head = i;
+	}
+
+	ue_work_tail = i;
+}
+
+/* Look for the neighbor in slot 'n' among the ones heard by UE 'ue'.
+ * Returns its position, or a negative number if the UE does not hear it.
+ */
+int ue_ngh_find(int ue, int n)
+{
+	int k;
+
+	for(k = 0; k < sim_ues[ue].nof_ngh; k++) {
+		if(ue_ngh_at(ue, k)->n == n) {
+			return k;
+		}
+	}
+
+	return -1;
+}
+
+/* Returns how many neighbors measurement 'j' of UE 'i' can report at most. */
+int ue_meas_cells(int i, int j)
+{
+	int c = sim_ues[i].meas[j].max_cells;
+
+	/* Serving cell takes one entry. */
+	if(c == 0 || c > UE_RRCM_MAX - 1) {
+		c = UE_RRCM_MAX - 1;
+	}
 
-	/* Check for already existing RNTIs, and continue to do us until a free
-	 * one has been found.
+	return c < (int)sim_nof_neigh ? c : (int)sim_nof_neigh;
+}
+
+/* Fills 'm', starting from entry 'mi', with the levels seen by UE 'i' for its
+ * measurement 'j': serving cell first, then the strongest neighbors above
+ * sim_meas_rsrp_min, up to the cap of the measurement.
+ * Returns the number of entries used in 'm'.
+ */
+int ue_meas_fill(int i, int j, ep_ue_measure * m, int mi)
+{
+	int         k;
+	int         p;
+	int         c  = ue_meas_cells(i, j);
+	int         nb = 0;
+	u8          l;
+	u8          lo = phy_rsrp_to_range(sim_meas_rsrp_min);
+	em_ue_ngh * e;
+	em_ue_ngh * best[UE_RRCM_MAX];
+	em_neigh *  g;
+
+	m[mi].meas_id = sim_ues[i].meas[j].id;
+	m[mi].pci     = sim_ues[i].meas[j].pci;
+	m[mi].rsrp    = phy_rsrp_from_range(sim_ues[i].meas[j].rs.rsrp);
+	m[mi].rsrq    = phy_rsrq_from_range(sim_ues[i].meas[j].rs.rsrq);
+
+	mi++;
+
+	/* Keep the best 'c' neighbors heard, strongest first, while looking;
+	 * the ones not heard are at the lowest levels anyhow.
 	 */
-	do {
-		e = 0;
+	for(k = 0; k < sim_ues[i].nof_ngh && c > 0; k++) {
+		e = ue_ngh_at(i, k);
+		g = sim_neighs[e->n];
+		l = e->rs.rsrp;
 
-		for(i = 0; i < UE_MAX; i++) {
-			if(f == -1 && sim_ues[i].rnti == UE_RNTI_INVALID) {
-				f = i;
-			}
+		/* Too weak, parked, or on a band the UE does not see. */
+		if(l <= lo || g->state == NEIGH_STATE_DEAD ||
+			!ue_band_has(i, g->band)) {
 
-			if(sim_ues[i].rnti == rnti) {
-				e    = 1;
-				rnti = ue_rnti_candidate();
+			continue;
+		}
 
-				/* Do not break here; we need to find an 'f'*/
-				if(f >= 0) {
-					break;
-				}
-			}
+		/* Not better than the weakest one kept. */
+		if(nb == c && l <= best[nb - 1]->rs.rsrp) {
+			continue;
+		}
 
-			/* Two UE with the same IMSI are not allowed! */
-			if(sim_ues[i].imsi == imsi) {
-				LOG_UE("IMSI %"PRIu64" already exists!\n",
-					imsi);
+		p = nb < c ? nb++ : nb - 1;
 
-				return ERR_UE_ADD_EXISTS;
-			}
+		for(; p > 0 && best[p - 1]->rs.rsrp < l; p--) {
+			best[p] = best[p - 1];
 		}
-	} while(e);
+
+		best[p] = e;
+	}
+
+	for(p = 0; p < nb; p++) {
+		e = best[p];
+
+		m[mi].meas_id = sim_ues[i].meas[j].id;
+		m[mi].pci     = (u16)sim_neighs[e->n]->pci;
+		m[mi].rsrp    = phy_rsrp_from_range(e->rs.rsrp);
+		m[mi].rsrq    = phy_rsrq_from_range(e->rs.rsrq);
+
+		mi++;
+	}
+
+	return mi;
+}
+
+/* Sends the report of measurement 'j' of UE 'i'. */
+void ue_meas_report(int i, int j)
+{
+	int           mi;
+	int           mlen;
+	char *        buf;
+	unsigned int  size;
+	ep_ue_measure m[UE_RRCM_MAX];
+
+	mi   = ue_meas_fill(i, j, m, 0);
+	buf  = rep_get(&size);
+	mlen = epf_trigger_uemeas_rep(
+		buf,
+		size,
+		sim_ID,
+		sim_ues[i].pci,
+		sim_ues[i].meas[j].mod_id,
+		mi,
+		UE_RRCM_MAX,
+		m);
+
+	rep_put(mlen);
+
+	/* Latest levels just sent; nothing left to report, unless the changes
+	 * still have to be evaluated against the event.
+	 */
+	if(sim_ues[i].meas[j].ev.type == EV_NONE) {
+		sim_ues[i].meas[j].dirty = 0;
+	}
+}
+
+/* Time for a periodic report of a measurement. */
+void ue_meas_timeout(em_timer * t)
+{
+	em_ue *      ue = (em_ue *)t->arg;
+	em_ue_rrcm * m  = tmr_entry(t, em_ue_rrcm, tmr);
+
+	if(!wrap_trigger_valid(m->tri_id, &m->tri_chk, tmr_now())) {
+		m->tri_id = 0;
+		m->mod_id = 0;
+		m->dirty  = 0;
+
+		return;
+	}
+
+	if(em_is_connected(sim_ID)) {
+		ue_meas_report(ue - sim_ues, m - ue->meas);
+	}
+
+	tmr_arm(t, m->interval);
+}
+
+/******************************************************************************
+ * Public accessible procedures:                                              *
+ ******************************************************************************/
+
+int ue_add(u16 pci, u32 earfcn, u16 rnti, u32 plmnid, u64 imsi, int rep)
+{
+	int i;
+	int f; /* Detected free UE slot. */
+
+	/* Two UE with the same IMSI are not allowed! */
+	if(hash_get(&ue_imsi_idx, imsi) != HASH_INVALID) {
+		LOG_UE("IMSI %"PRIu64" already exists!\n", imsi);
+		return ERR_UE_ADD_EXISTS;
+	}
+
+	for(f = ue_free_hint; f < UE_MAX; f++) {
+		if(sim_ues[f].rnti == UE_RNTI_INVALID) {
+			break;
+		}
+	}
+
+	ue_free_hint = f;
 
 	/* No slots available. */
-	if(f < 0) {
+	if(f == UE_MAX) {
 		LOG_UE("No more free UE slots available.\n");
 		return ERR_UE_ADD_FULL;
 	}
 
-	/* Clean everything before the use. */
-	memset(&sim_ues[f], 0, sizeof(em_ue));
-
 	/* Check the validity of the Physical Cell ID */
 	for(i = 0; i < PHY_CELL_MAX; i++) {
 		if(sim_phy.cells[i].pci == pci) {
@@ -101,13 +431,38 @@ int ue_add(u16 pci, u32 earfcn, u16 rnti, u32 plmnid, u64 imsi, int rep)
 		return ERR_UE_ADD_PCI_UNKNOWN;
 	}
 
+	/* Keep the requested RNTI if possible, otherwise assign a free one. */
+	if(ue_rnti_take(rnti)) {
+		rnti = ue_rnti_alloc();
+
+		if(rnti == UE_RNTI_INVALID) {
+			LOG_UE("No more free RNTIs available.\n");
+			return ERR_UE_ADD_FULL;
+		}
+	}
+
+	/* Clean everything before the use. */
+	memset(&sim_ues[f], 0, sizeof(em_ue));
+
 	sim_ues[f].pci   = pci;
 	sim_ues[f].rnti  = rnti;
 	sim_ues[f].plmn  = plmnid;
 	sim_ues[f].imsi  = imsi;
 
-	/* WARN: Hard-coded operating on band 7. */
-	sim_ues[f].bands[0]        = 7;
+	ue_free_hint = f + 1;
+
+	/* Slots are always there for UE_MAX elements. */
+	hash_put(&ue_rnti_idx, rnti, f);
+	hash_put(&ue_imsi_idx, imsi, f);
+
+	/* The UE works at least on the band of its cell. */
+	memcpy(sim_ues[f].bands, sim_ue_bands, sizeof(sim_ue_bands));
+
+	i = phy_earfcn_to_band(earfcn);
+
+	if(i != PHY_BAND_INVALID && i < UE_BAND_MAX) {
+		sim_ues[f].bands[i / 64] |= 1ULL << (i % 64);
+	}
 
 	/* Measurements on place in the UE; by default the slot 0 is reserved
 	 * to measurements on the attached cell. */
@@ -117,13 +472,16 @@ int ue_add(u16 pci, u32 earfcn, u16 rnti, u32 plmnid, u64 imsi, int rep)
 	sim_ues[f].meas[0].earfcn  = earfcn;
 
 	/* By default the level of the reference signal is at half. */
-	sim_ues[f].meas[0].rs.rsrp =
-		PHY_RSRP_LOWER - (PHY_RSRP_LOWER - PHY_RSRP_HIGHER) / 2;
-	sim_ues[f].meas[0].rs.rsrq =
-		PHY_RSRQ_LOWER - (PHY_RSRQ_LOWER - PHY_RSRQ_HIGHER) / 2;
+	sim_ues[f].meas[0].rs.rsrp = phy_rsrp_to_range(
+		PHY_RSRP_LOWER - (PHY_RSRP_LOWER - PHY_RSRP_HIGHER) / 2);
+	sim_ues[f].meas[0].rs.rsrq = phy_rsrq_to_range(
+		PHY_RSRQ_LOWER - (PHY_RSRQ_LOWER - PHY_RSRQ_HIGHER) / 2);
 
 	/* Force the first feedback feedback. */
-	sim_ues[f].meas[0].dirty   = 1;
+	ue_meas_dirty(f, 0);
+
+	sim_ues[f].ev              = sim_ev;
+	sim_ues[f].meas[0].ev      = sim_ev;
 
 	sim_nof_ues++;
 
@@ -146,62 +504,255 @@ int ue_add(u16 pci, u32 earfcn, u16 rnti, u32 plmnid, u64 imsi, int rep)
 	return f;
 }
 
+void ue_rep_request(void)
+{
+	sim_ue_dirty = 1;
+	ue_rep_next  = 0;
+}
+
 int ue_rem(u16 rnti, int rep)
 {
-	int i;
+	int i = ue_find_rnti(rnti);
 	int j;
 
-	for(i = 0; i < UE_MAX; i++) {
-		if(sim_ues[i].rnti == rnti) {
-			sim_nof_ues--;
-
-			sim_ues[i].rnti = UE_RNTI_INVALID;
-			sim_ues[i].imsi = 0;
-			sim_ues[i].plmn = 0;
-			sim_ues[i].pci  = 0;
-
-			/* Reset RRC measurements for that UE */
-			for(j = 0; j < UE_RRCM_MAX; j++) {
-				if(sim_ues[i].meas[j].tri_id) {
-					/* Remove the eventual trigger */
-					em_del_trigger(
-						sim_ID,
-						 sim_ues[i].meas[j].tri_id);
-				}
+	if(i < 0) {
+		return ERR_UE_REM_NOT_FOUND;
+	}
 
-				sim_ues[i].meas[j].id     = 0;
-				sim_ues[i].meas[j].tri_id = 0;
-				sim_ues[i].meas[j].mod_id = 0;
-			}
+	sim_nof_ues--;
 
-			/* Reset the reference signal measured for every
-			 * neighbor cell.
-			 */
-			for(j = 0; j < NEIGH_MAX; j++) {
-				sim_neighs[j].rs[i].rsrp = PHY_RSRP_LOWER;
-				sim_neighs[j].rs[i].rsrq = PHY_RSRQ_LOWER;
-			}
+	hash_del(&ue_rnti_idx, rnti);
+	hash_del(&ue_imsi_idx, sim_ues[i].imsi);
+	ue_rnti_free(rnti);
 
-			if (sim_mac.ran) {
-				ran_rem_user(rnti, 0);
-			}
+	if(rep) {
+		/* Signal that the UEs list is dirty and shall be reported. */
+		sim_ue_dirty = 1;
+	}
 
-			LOG_UE("UE %u removed\n", rnti);
+	/* Nothing left to look at; the slot leaves the list on next step. */
+	ue_work_mask[i] = 0;
 
-			break;
+	sim_ues[i].rnti = UE_RNTI_INVALID;
+	sim_ues[i].imsi = 0;
+	sim_ues[i].plmn = 0;
+	sim_ues[i].pci  = 0;
+
+	if((u32)i < ue_free_hint) {
+		ue_free_hint = (u32)i;
+	}
+
+	/* Reset RRC measurements for that UE */
+	for(j = 0; j < UE_RRCM_MAX; j++) {
+		if(sim_ues[i].meas[j].tri_id) {
+			/* Remove the eventual trigger */
+			em_del_trigger(sim_ID, sim_ues[i].meas[j].tri_id);
 		}
+
+		sim_ues[i].meas[j].id     = 0;
+		sim_ues[i].meas[j].tri_id = 0;
+		sim_ues[i].meas[j].mod_id = 0;
+
+		tmr_cancel(&sim_ues[i].meas[j].tmr);
 	}
 
-	if(rep) {
-		sim_ue_dirty = 1;
+	/* Forget the reference signal measured for every neighbor cell. */
+	ue_ngh_clear(i);
+
+	/* Gone before the target answered. */
+	sim_ues[i].ho_state = UE_HO_NONE;
+	sim_ues[i].ho_due   = 0;
+	tmr_cancel(&sim_ues[i].ho_tmr);
+
+	if (sim_mac.ran) {
+		ran_rem_user(rnti, 0);
+	}
+
+	LOG_UE("UE %u removed\n", rnti);
+
+	return SUCCESS;
+}
+
+int ue_bands_parse(char * str, char * sep, u64 * bands)
+{
+	char * curr;
+	char * t;
+	int    b;
+	int    n = 0;
+
+	memset(bands, 0, sizeof(u64) * UE_BAND_WORDS);
+
+	for(t = strtok_r(str, sep, &curr); t; t = strtok_r(0, sep, &curr)) {
+		b = atoi(t);
+
+		if(b <= UE_BAND_INVALID || b >= UE_BAND_MAX) {
+			return ERR_UE_BAND_INVALID;
+		}
+
+		bands[b / 64] |= 1ULL << (b % 64);
+		n++;
+	}
+
+	return n;
+}
+
+int ue_bands_format(u64 * bands, char * sep, char * buf, int len)
+{
+	int b;
+	int l = 0;
+
+	buf[0] = 0;
+
+	for(b = UE_BAND_INVALID + 1; b < UE_BAND_MAX && l < len; b++) {
+		if(!((bands[b / 64] >> (b % 64)) & 1)) {
+			continue;
+		}
+
+		l += snprintf(buf + l, len - l, "%s%d", l ? sep : "", b);
+	}
+
+	return l < len ? l : len - 1;
+}
+
+int ue_band_check(int ue, u32 earfcn)
+{
+	u32 b = phy_earfcn_to_band(earfcn);
+
+	return b != PHY_BAND_INVALID && ue_band_has(ue, b);
+}
+
+void ue_ngh_get(int ue, int n, em_phy_rs * rs)
+{
+	int k = ue_ngh_find(ue, n);
+
+	if(k < 0) {
+		rs->rsrp = phy_rsrp_to_range(PHY_RSRP_LOWER);
+		rs->rsrq = phy_rsrq_to_range(PHY_RSRQ_LOWER);
+		return;
+	}
+
+	*rs = ue_ngh_at(ue, k)->rs;
+}
+
+int ue_ngh_set(int ue, int n, em_phy_rs * rs)
+{
+	em_ue *     u = &sim_ues[ue];
+	em_ue_ngh * x;
+	int         k = ue_ngh_find(ue, n);
+	int         c;
+
+	/* At the lowest levels the neighbor is not heard at all. */
+	if(rs->rsrp <= phy_rsrp_to_range(PHY_RSRP_LOWER) &&
+		rs->rsrq <= phy_rsrq_to_range(PHY_RSRQ_LOWER)) {
+
+		if(k >= 0) {
+			*ue_ngh_at(ue, k) = *ue_ngh_at(ue, u->nof_ngh - 1);
+			u->nof_ngh--;
+		}
+
+		return SUCCESS;
+	}
+
+	if(k >= 0) {
+		ue_ngh_at(ue, k)->rs = *rs;
+		return SUCCESS;
+	}
+
+	/* Inline entries are over; make room in the heap. */
+	if(u->nof_ngh >= UE_NGH_INLINE + u->ngh_cap) {
+		c = u->ngh_cap ? u->ngh_cap * 2 : UE_NGH_INLINE;
+		x = realloc(u->ngh_ext, sizeof(em_ue_ngh) * c);
+
+		if(!x) {
+			LOG_UE("No memory for neighbors of UE %u\n", u->rnti);
+			return ERR_UE_NGH_MEM;
+		}
+
+		u->ngh_ext = x;
+		u->ngh_cap = (u16)c;
 	}
 
+	k = u->nof_ngh++;
+
+	ue_ngh_at(ue, k)->n  = (u16)n;
+	ue_ngh_at(ue, k)->rs = *rs;
+
 	return SUCCESS;
 }
 
-u16 ue_rnti_candidate(void)
+void ue_ngh_clear(int ue)
+{
+	free(sim_ues[ue].ngh_ext);
+
+	sim_ues[ue].ngh_ext = 0;
+	sim_ues[ue].ngh_cap = 0;
+	sim_ues[ue].nof_ngh = 0;
+}
+
+void ue_ngh_drop(int n)
+{
+	em_phy_rs rs;
+	int       i;
+
+	rs.rsrp = phy_rsrp_to_range(PHY_RSRP_LOWER);
+	rs.rsrq = phy_rsrq_to_range(PHY_RSRQ_LOWER);
+
+	for(i = 0; i < UE_MAX; i++) {
+		if(sim_ues[i].nof_ngh) {
+			ue_ngh_set(i, n, &rs);
+		}
+	}
+}
+
+int ue_find_rnti(u16 rnti)
+{
+	return hash_get(&ue_rnti_idx, rnti);
+}
+
+int ue_find_imsi(u64 imsi)
+{
+	return hash_get(&ue_imsi_idx, imsi);
+}
+
+void ue_meas_dirty(int ue, int meas)
+{
+	sim_ues[ue].meas[meas].dirty = 1;
+	ue_work_add(ue, meas);
+}
+
+void ue_meas_schedule(int ue, int meas)
+{
+	em_ue_rrcm * m = &sim_ues[ue].meas[meas];
+
+	if(m->interval == 0) {
+		tmr_cancel(&m->tmr);
+		return;
+	}
+
+	if(!tmr_armed(&m->tmr)) {
+		tmr_init(&m->tmr, ue_meas_timeout, &sim_ues[ue]);
+	}
+
+	tmr_arm(&m->tmr, m->interval);
+}
+
+int ue_init(void)
 {
-	return (u16)(rand() % (UE_RNTI_RESERVED - 1)) + 1;
+	if(hash_init(&ue_rnti_idx, UE_MAX) ||
+		hash_init(&ue_imsi_idx, UE_MAX)) {
+
+		LOG_UE("Cannot allocate UE indexes!\n");
+		return ERR_UE_INIT_INDEX;
+	}
+
+	/* RNTI 0 and the reserved area can never be assigned. */
+	ue_rnti_map[0] |= 1ULL;
+	ue_rnti_map[UE_RNTI_MAP_WORDS - 1] |=
+		~0ULL << (UE_RNTI_RESERVED & 63);
+
+	ue_rnti_seed = (u32)time(NULL) | 1;
+
+	return SUCCESS;
 }
 
 /******************************************************************************
@@ -213,82 +764,137 @@ u32 ue_compute_measurements()
 	int           i;
 	int           j;
 	int           k;
+	int           n;
 
 	int           mlen;
-	char          buf[MEDIUM_BUF];
+	char *        buf;
+	unsigned int  size;
 
 	int           mi;
+	int           mn;
+	u32           mod;
+	u32           mask;
+	u32           todo;
 	ep_ue_measure m[UE_RRCM_MAX];
 
+	u64           now = tmr_now();
+
 	/* Do not compute on disconnected controller. */
 	if(!em_is_connected(sim_ID)) {
 		return SUCCESS;
 	}
 
-	for(i = 0; i < UE_MAX; i++) {
+	/* Take the list as it is now; evaluations can add UEs for the next
+	 * step.
+	 */
+	i            = ue_work_head;
+	ue_work_head = -1;
+	ue_work_tail = -1;
+
+	for(; i >= 0; i = n) {
+		n               = ue_work_next[i];
+		mask            = ue_work_mask[i];
+		ue_work_in[i]   = 0;
+		ue_work_mask[i] = 0;
+
 		if(sim_ues[i].rnti == UE_RNTI_INVALID) {
 			continue;
 		}
 
-		for(j = 0; j < UE_RRCM_MAX; j++) {
+		for(todo = mask; todo; todo &= todo - 1) {
+			j = __builtin_ctz(todo);
+
+			/* No one asked for it (yet). */
 			if(sim_ues[i].meas[j].tri_id == 0) {
+				mask &= ~(1U << j);
 				continue;
 			}
 
 			/* Trigger removed; clean up */
-			if(!em_has_trigger(
-				sim_ID, sim_ues[i].meas[j].tri_id)) {
+			if(!wrap_trigger_valid(
+				sim_ues[i].meas[j].tri_id,
+				&sim_ues[i].meas[j].tri_chk,
+				now)) {
 
 				/* Invalidate the trigger. */
 				sim_ues[i].meas[j].tri_id = 0;
 				sim_ues[i].meas[j].mod_id = 0;
 				sim_ues[i].meas[j].dirty  = 0;
 
+				tmr_cancel(&sim_ues[i].meas[j].tmr);
+
+				mask &= ~(1U << j);
 				continue;
 			}
 
+			/* Event-triggered measurements report only when the
+			 * event fires; changes of levels (or a pending
+			 * time-to-trigger) just cause an evaluation.
+			 */
+			if(sim_ues[i].meas[j].ev.type != EV_NONE) {
+				sim_ues[i].meas[j].dirty = ev_check(i, j, now);
+
+				if(sim_ues[i].meas[j].ev_state ==
+					EV_STATE_PENDING) {
+
+					ue_work_add(i, j);
+				}
+			}
+
+			if(!sim_ues[i].meas[j].dirty) {
+				mask &= ~(1U << j);
+			}
+		}
+
+		for(; mask; mask &= mask - 1) {
+			j = __builtin_ctz(mask);
+
 			if(!sim_ues[i].meas[j].dirty) {
 				continue;
 			}
 
-			mi = 0;
+			/* Measurements of the UE requested by the same module
+			 * travel in the same report, as long as they fit.
+			 */
+			mod = sim_ues[i].meas[j].mod_id;
 
-			m[mi].meas_id = sim_ues[i].meas[j].id;
-			m[mi].pci     = sim_ues[i].meas[j].pci;
-			m[mi].rsrp    = sim_ues[i].meas[j].rs.rsrp;
-			m[mi].rsrq    = sim_ues[i].meas[j].rs.rsrq;
+			for(todo = mask, mi = 0; todo; todo &= todo - 1) {
+				k = __builtin_ctz(todo);
 
-			mi++;
+				if(!sim_ues[i].meas[k].dirty ||
+					sim_ues[i].meas[k].mod_id != mod) {
 
-			/* Look in every neighbor for measurements */
-			for(k = 0 ; k < NEIGH_MAX; k++) {
-				/* Skip neighbor */
-				if(sim_neighs[k].id == NEIGH_INVALID_ID) {
 					continue;
 				}
 
-				m[mi].meas_id = sim_ues[i].meas[j].id;
-				m[mi].pci     = (u16)sim_neighs[k].pci;
-				m[mi].rsrp    = sim_neighs[k].rs[i].rsrp;
-				m[mi].rsrq    = sim_neighs[k].rs[i].rsrq;
+				/* Entries taken by the measurement in a report. */
+				mn = 1 + ue_meas_cells(i, k);
+
+				/* Still dirty: it goes in a further report of this
+				 * same step.
+				 */
+				if(mi + mn > UE_RRCM_MAX) {
+					continue;
+				}
 
-				mi++;
+				mi = ue_meas_fill(i, k, m, mi);
+
+				/* Keep it dirty if some error occurs. */
+				sim_ues[i].meas[k].dirty = 0;
 			}
 
+			buf  = rep_get(&size);
 			mlen = epf_trigger_uemeas_rep(
 				buf,
-				MEDIUM_BUF,
+				size,
 				sim_ID,
 				sim_ues[i].pci,
-				sim_ues[i].meas[j].mod_id,
+				mod,
 				mi,
 				UE_RRCM_MAX,
 				m);
 
-			em_send(sim_ID, buf, mlen);
-
-			/* Keep it dirty if some error occurs. */
-			sim_ues[i].meas[j].dirty = 0;
+			rep_put(mlen);
 		}
 	}
 
@@ -297,14 +903,6 @@ u32 ue_compute_measurements()
 
 u32 ue_compute(void)
 {
-	int           i;
-
-	int           mlen;
-	char          buf[MEDIUM_BUF];
-
-	int           nof_ues;
-	ep_ue_details ued[32];
-
 	/* Do not compute on disconnected controller. */
 	if(!em_is_connected(sim_ID)) {
 		return SUCCESS;
@@ -312,53 +910,17 @@ u32 ue_compute(void)
 
 	/*
 	 * If the UEs simulated are marked as dirty, the system will report to
-	 * the controller in the case a trigger has been setup.
+	 * the controller in the case a trigger has been setup. Changes which
+	 * come closer than sim_ue_rep_int end up in the same report.
 	 */
-	if(sim_ue_dirty) {
-		/* Check every time is the trigger is still there. */
-		if(!em_has_trigger(
-			sim_ID,
-			sim_UE_rep_trigger))  {
+	if(sim_ue_dirty && tmr_now() >= ue_rep_next && wrap_trigger_valid(
+		sim_UE_rep_trigger, &sim_UE_rep_chk, tmr_now())) {
 
-			return 0;
+		/* Failures keep the flag dirty, to try again next step. */
+		if(!ue_rep_all()) {
+			ue_rep_next  = tmr_now() + sim_ue_rep_int;
+			sim_ue_dirty = 0;
 		}
-
-		for(i = 0, nof_ues = 0; i < UE_MAX; i++) {
-			if(sim_ues[i].rnti == UE_RNTI_INVALID) {
-				continue;
-			}
-
-			/* We have a limited amount of RRC meas. to send */
-			if(nof_ues >= sim_UE_rep_max) {
-				break;
-			}
-
-			ued[nof_ues].rnti = sim_ues[i].rnti;
-			ued[nof_ues].imsi = sim_ues[i].imsi;
-			ued[nof_ues].plmn = sim_ues[i].plmn;
-			ued[nof_ues].pci  = sim_ues[i].pci;
-
-			nof_ues++;
-		}
-
-		mlen = epf_trigger_uerep_rep(
-			buf,
-			MEDIUM_BUF,
-			sim_ID,
-			sim_phy.cells[0].pci,
-			sim_UE_rep_mod,
-			nof_ues,
-			sim_UE_rep_max,
-			ued);
-
-		if(mlen > 0) {
-			em_send(sim_ID, buf, mlen);
-		}
-
-		/* No dirty anymore.
-		 * Failures keeps the flag dirty.
-		 */
-		sim_ue_dirty = 0;
 	}
 
 		/* Perform computation on UE measurement level. */
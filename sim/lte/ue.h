@@ -20,7 +20,9 @@
 #ifndef __EM_SIM_UE_H
 #define __EM_SIM_UE_H
 
+#include "event.h"
 #include "stack.h"
+#include "timer.h"
 
 /******************************************************************************
  * RNTI information.                                                          *
@@ -43,13 +45,18 @@
 #define UE_RNTI_P			0xfffe
 #define UE_RNTI_SI			0xffff
 
+/* Number of 64 bits words of the RNTI allocation bitmap. */
+#define UE_RNTI_MAP_WORDS		((UE_RNTI_SI + 1) / 64)
+
 /* Max number of UE taken in account. */
-#define UE_MAX				32
+#define UE_MAX				4096
 
-/* Maximum number of supported bands. */
-#define UE_BAND_MAX			32
+/* Bands are numbered from 1 to UE_BAND_MAX - 1. */
+#define UE_BAND_MAX			128
 /* Invalid band identifier. */
 #define UE_BAND_INVALID			0
+/* Number of 64 bits words of a set of bands. */
+#define UE_BAND_WORDS			(UE_BAND_MAX / 64)
 
 /* Maximum number of measurements that can be issued on a UE. */
 #define UE_RRCM_MAX			32
@@ -63,13 +70,19 @@ typedef struct __em_sim_rrc_measurement {
 
 	/* Trigger id assigned by the agent subsystem. */
 	u32       tri_id;
+	/* When the trigger shall be checked again with the agent, in ms. */
+	u64       tri_chk;
 	/* Module which requested the measure. */
 	u32       mod_id;
 
 	/* Frequency to scan. */
 	u32       earfcn;
-	/* Interval for the report */
+	/* Interval for the report, in ms; 0 for no periodic report. */
 	uint16_t  interval;
+	/* Max number of neighbors reported; 0 for as many as fit. */
+	u16       max_cells;
+	/* Next periodic report. */
+	em_timer  tmr;
 
 	/* PCI detected on such measurement, if any. */
 	u16       pci;
@@ -81,8 +94,34 @@ typedef struct __em_sim_rrc_measurement {
 
 	/* Modifications occurs on such measurements? */
 	u32       dirty;
+
+	/* Event which triggers the reports. */
+	em_ev     ev;
+	/* State of the event evaluation. */
+	u32       ev_state;
+	/* When the entering condition of the event started to hold, in ms. */
+	u64       ev_since;
 } em_ue_rrcm;
 
+/* Neighbors whose levels are kept within the UE; more go to the heap. */
+#define UE_NGH_INLINE			6
+
+/* Levels at which a UE receives a neighbor cell. */
+typedef struct __em_sim_ue_neighbor {
+	/* Slot of the neighbor cell. */
+	u16       n;
+	/* Reference signal power/quality. */
+	em_phy_rs rs;
+} em_ue_ngh;
+
+/* Hand-over states of an UE. */
+enum ue_ho_states {
+	/* No hand-over in progress. */
+	UE_HO_NONE = 0,
+	/* Request sent to the target eNB, waiting for its answer. */
+	UE_HO_PREPARING,
+};
+
 /* Describes the UE */
 typedef struct __em_sim_user_equipment{
 	/* Cell at which the UE is attached */
@@ -97,11 +136,42 @@ typedef struct __em_sim_user_equipment{
 	/* International Mobile Subscriber Identity. */
 	u64 imsi;
 
-	/* Bands on which the UE can operate on. */
-	u32 bands[UE_BAND_MAX];
+	/* Neighbors received above the lowest levels; the others are not
+	 * kept. The first UE_NGH_INLINE are in 'ngh', the rest in 'ngh_ext'.
+	 */
+	u16         nof_ngh;
+	/* Entries allocated in 'ngh_ext'. */
+	u16         ngh_cap;
+	em_ue_ngh   ngh[UE_NGH_INLINE];
+	em_ue_ngh * ngh_ext;
+
+	/* Bands on which the UE can operate on, one bit each. */
+	u64 bands[UE_BAND_WORDS];
 
 	/* Measurements issued to an UE. */
 	em_ue_rrcm meas[UE_RRCM_MAX];
+
+	/* Event given to the new measurements of the UE. */
+	em_ev ev;
+
+	/* State of the hand-over; the UE stays here until the target eNB
+	 * acknowledges it.
+	 */
+	u32      ho_state;
+	/* Sequence number of the hand-over request. */
+	u32      ho_seq;
+	/* Id of the target eNB. */
+	u32      ho_enb;
+	/* Module which asked for the hand-over. */
+	u32      ho_mod;
+	/* Requests sent so far. */
+	u32      ho_tries;
+	/* Is the request waiting for the next send stage? */
+	u32      ho_due;
+	/* When the hand-over started, in ms. */
+	u64      ho_start;
+	/* Sends the request again if no answer comes. */
+	em_timer ho_tmr;
 } em_ue;
 
 /******************************************************************************
@@ -117,6 +187,41 @@ extern em_ue sim_ues[UE_MAX];
 /* Identify if some modifications occurs on the UE list. */
 extern u32 sim_ue_dirty;
 
+/* Minimum time between two reports of the UE list, in ms; 0 reports it at
+ * every step where it changed.
+ */
+extern u32 sim_ue_rep_int;
+
+/* Assign RNTIs in a random order rather than sequentially? */
+extern u32 sim_rnti_rand;
+
+/* Neighbors must be received above this RSRP to be reported. */
+extern sp sim_meas_rsrp_min;
+
+/* Bands given to the new UEs, besides the one of their cell. */
+extern u64 sim_ue_bands[UE_BAND_WORDS];
+
+/******************************************************************************
+ * Inline procedures:                                                         *
+ ******************************************************************************/
+
+/* Returns the k-th neighbor heard by UE 'ue'. */
+static inline em_ue_ngh * ue_ngh_at(int ue, int k)
+{
+	return k < UE_NGH_INLINE ?
+		&sim_ues[ue].ngh[k] : &sim_ues[ue].ngh_ext[k - UE_NGH_INLINE];
+}
+
+/* Tells if UE 'ue' can operate on band 'band'; unknown bands are seen. */
+static inline int ue_band_has(int ue, u32 band)
+{
+	if(band == UE_BAND_INVALID || band >= UE_BAND_MAX) {
+		return band == UE_BAND_INVALID;
+	}
+
+	return (sim_ues[ue].bands[band / 64] >> (band % 64)) & 1;
+}
+
 /******************************************************************************
  * Public accessible procedures:                                              *
  ******************************************************************************/
@@ -146,6 +251,67 @@ int ue_add(
  */
 u32 ue_compute(void);
 
+/* Parses a list of bands separated by any of the characters in 'sep' into
+ * the set 'bands', which is cleared first.
+ * Returns the number of bands, otherwise a negative error code.
+ */
+int ue_bands_parse(char * str, char * sep, u64 * bands);
+
+/* Writes the bands of set 'bands' in 'buf', separated by 'sep'.
+ * Returns the length of the string written.
+ */
+int ue_bands_format(u64 * bands, char * sep, char * buf, int len);
+
+/* Tells if UE 'ue' supports the band of the downlink EARFCN 'earfcn'. */
+int ue_band_check(int ue, u32 earfcn);
+
+/* Gets in 'rs' the levels at which UE 'ue' receives the neighbor in slot
+ * 'n'; the lowest ones if the UE does not hear it.
+ */
+void ue_ngh_get(int ue, int n, em_phy_rs * rs);
+
+/* Sets the levels at which UE 'ue' receives the neighbor in slot 'n'; the
+ * lowest levels forget the neighbor.
+ * Returns 0 on success, otherwise a negative error code.
+ */
+int ue_ngh_set(int ue, int n, em_phy_rs * rs);
+
+/* Forgets all the neighbors heard by UE 'ue'. */
+void ue_ngh_clear(int ue);
+
+/* Forgets the neighbor in slot 'n' in all the UEs. */
+void ue_ngh_drop(int n);
+
+/* Look for the slot of an UE using its RNTI.
+ * Returns the UE slot index, or a negative number if not found.
+ */
+int ue_find_rnti(u16 rnti);
+
+/* Look for the slot of an UE using its IMSI.
+ * Returns the UE slot index, or a negative number if not found.
+ */
+int ue_find_imsi(u64 imsi);
+
+/* Marks a measurement of an UE as changed, so that it will be evaluated and
+ * reported during the next step.
+ */
+void ue_meas_dirty(int ue, int meas);
+
+/* Schedules the periodic reports of a measurement of an UE, following its
+ * interval; an interval of 0 stops them.
+ */
+void ue_meas_schedule(int ue, int meas);
+
+/* Initializes the UE module.
+ * Returns 0 on success, otherwise a negative error code.
+ */
+int ue_init(void);
+
+/* The controller asked for the UE list; it is reported during the next step,
+ * however close to the last report.
+ */
+void ue_rep_request(void);
+
 /* Removes a managed UE by looking for its RNTI.
  * Returns 0 on success, otherwise a negative error code.
  */
@@ -155,8 +321,20 @@ int ue_rem(
 	/* Triggers an eventual UE report? */
 	int rep);
 
-/* Returns a possible candidate for an UE RNTI.
+/* Assigns a free RNTI from the valid range. By default RNTIs are assigned
+ * sequentially, starting after the last one given; if sim_rnti_rand is set the
+ * search starts from a random point instead.
+ *
+ * Returns the RNTI, or UE_RNTI_INVALID if all of them are in use.
+ */
+u16 ue_rnti_alloc(void);
+
+/* Marks a specific RNTI as in use.
+ * Returns 0 on success, otherwise a negative error code.
  */
-u16 ue_rnti_candidate(void);
+int ue_rnti_take(u16 rnti);
+
+/* Gives back an RNTI, which can then be assigned again. */
+void ue_rnti_free(u16 rnti);
 
 #endif /* __EM_SIM_UE_H */
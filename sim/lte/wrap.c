@@ -33,12 +33,36 @@
 s32 sim_UE_rep_max         = 32;
 u32 sim_UE_rep_mod         = 0;
 s32 sim_UE_rep_trigger     = 0;
+u64 sim_UE_rep_chk         = 0;
 
 s32 sim_cell_stats_trigger = 0;
 u32 sim_cell_stat_mod      = 0;
 
 char * sim_ue_buf;
 
+/******************************************************************************
+ * Public accessible procedures:                                              *
+ ******************************************************************************/
+
+int wrap_trigger_valid(int tid, u64 * chk, u64 now)
+{
+	if(tid == 0) {
+		return 0;
+	}
+
+	if(now < *chk) {
+		return 1;
+	}
+
+	if(!em_has_trigger(sim_ID, tid)) {
+		return 0;
+	}
+
+	*chk = now + WRAP_TRIGGER_TTL;
+
+	return 1;
+}
+
 /******************************************************************************
  * Callback implementation.                                                   *
  ******************************************************************************/
@@ -83,6 +107,8 @@ int wrap_disconnected()
 			sim_ues[i].meas[j].id       = 0;
 			sim_ues[i].meas[j].mod_id   = 0;
 			sim_ues[i].meas[j].tri_id   = 0;
+
+			tmr_cancel(&sim_ues[i].meas[j].tmr);
 		}
 	}
 
@@ -94,6 +120,7 @@ int wrap_disconnected()
 
 	for(i = 0; i < MAC_REPORT_MAX; i++) {
 		sim_mac.mac_rep[i].mod = 0;
+		tmr_cancel(&sim_mac.mac_rep[i].tmr);
 	}
 
 	return 0;
@@ -206,7 +233,8 @@ int wrap_handover(
 
 	LOG_WRAP("UE handover requested for RNTI %d\n", rnti);
 
-	if (x2_hand_over(rnti, target_enb)) {
+	/* The UE leaves once the target eNB acknowledges it. */
+	if (x2_hand_over(rnti, target_enb, mod)) {
 		LOG_WRAP("Failed to hand RNTI %d over\n", rnti);
 
 		blen = epf_single_ho_rep_fail(
@@ -225,8 +253,6 @@ int wrap_handover(
 		return -1;
 	}
 
-	ue_rem(rnti, 0);
-
 	return 0;
 }
 
@@ -236,7 +262,9 @@ int wrap_ue_report(uint32_t mod, int trig_id)
 
 	sim_UE_rep_trigger = trig_id;
 	sim_UE_rep_mod     = mod;
-	sim_ue_dirty       = 1;
+	sim_UE_rep_chk     = tmr_now() + WRAP_TRIGGER_TTL;
+
+	ue_rep_request();
 
 	return 0;
 }
@@ -260,14 +288,10 @@ int wrap_ue_measure(
 	LOG_WRAP("Controller module %d requested UE %d measure %d on freq %d\n",
 		mod, rnti, measure_id, earfcn);
 
-	for(i = 0; i < UE_MAX; i++) {
-		if(sim_ues[i].rnti == rnti) {
-			break;
-		}
-	}
+	i = ue_find_rnti(rnti);
 
 	/* UE not found */
-	if(i == UE_MAX) {
+	if(i < 0) {
 		LOG_WRAP("UE %d not found\n", rnti);
 
 		blen = epf_trigger_uemeas_rep_fail(
@@ -283,10 +307,40 @@ int wrap_ue_measure(
 		return -1;
 	}
 
-	for(j = 0; j < UE_RRCM_MAX; j++) {
+	/* The UE cannot measure on a band it does not support. */
+	if(!ue_band_check(i, earfcn)) {
+		LOG_WRAP("UE %d does not support EARFCN %d\n", rnti, earfcn);
+
+		blen = epf_trigger_uemeas_rep_fail(
+			buf, MEDIUM_BUF, sim_ID, 0, mod);
+
+		if(blen < 0) {
+			LOG_WRAP("Cannot format UE measure reply!\n");
+			return -1;
+		}
+
+		em_send(sim_ID, buf, blen);
+
+		return -1;
+	}
+
+	/* Slot 0 is the serving cell, which no trigger asked for. */
+	for(j = 1; j < UE_RRCM_MAX; j++) {
 		if(sim_ues[i].meas[j].tri_id == 0) {
 			break;
 		}
+
+		/* Idle measurements are not looked at while nothing changes;
+		 * take back the ones whose trigger is gone.
+		 */
+		if(!wrap_trigger_valid(
+			sim_ues[i].meas[j].tri_id,
+			&sim_ues[i].meas[j].tri_chk,
+			tmr_now())) {
+
+			tmr_cancel(&sim_ues[i].meas[j].tmr);
+			break;
+		}
 	}
 
 	if(j == UE_RRCM_MAX) {
@@ -312,8 +366,14 @@ int wrap_ue_measure(
 			sim_ues[i].meas[k].id       = measure_id;
 			sim_ues[i].meas[k].mod_id   = mod;
 			sim_ues[i].meas[k].tri_id   = trig_id;
+			sim_ues[i].meas[k].tri_chk  = tmr_now() + WRAP_TRIGGER_TTL;
+			sim_ues[i].meas[k].interval = interval;
+			sim_ues[i].meas[k].max_cells =
+				max_cells > 0 ? (u16)max_cells : 0;
 			/* Send an update of such measure */
-			sim_ues[i].meas[k].dirty    = 1;
+			ue_meas_dirty(i, k);
+
+			ue_meas_schedule(i, k);
 
 			return 0;
 		}
@@ -322,21 +382,28 @@ int wrap_ue_measure(
 	sim_ues[i].meas[j].id       = measure_id;
 	sim_ues[i].meas[j].mod_id   = mod;
 	sim_ues[i].meas[j].tri_id   = trig_id;
-	/* NOTE:
-	 * Does the UE support such earfcn?
-	 * Add support for bands.
-	 */
+	/* Just received from the agent, no need to check it soon. */
+	sim_ues[i].meas[j].tri_chk  = tmr_now() + WRAP_TRIGGER_TTL;
 	sim_ues[i].meas[j].earfcn   = earfcn;
 	sim_ues[i].meas[j].interval = interval;
+	sim_ues[i].meas[j].max_cells =
+		max_cells > 0 ? (u16)max_cells : 0;
+	sim_ues[i].meas[j].ev       = sim_ues[i].ev;
+	sim_ues[i].meas[j].ev_state = EV_STATE_IDLE;
 
 	if(sim_ues[i].meas[j].rs.rsrp == 0) {
-		sim_ues[i].meas[j].rs.rsrp  = PHY_RSRP_LOWER + 10.0;
+		sim_ues[i].meas[j].rs.rsrp  =
+			phy_rsrp_to_range(PHY_RSRP_LOWER + 10.0);
 	}
 
 	if(sim_ues[i].meas[j].rs.rsrq == 0) {
-		sim_ues[i].meas[j].rs.rsrq  = PHY_RSRQ_LOWER +  5.0;
+		sim_ues[i].meas[j].rs.rsrq  =
+			phy_rsrq_to_range(PHY_RSRQ_LOWER +  5.0);
 	}
 
+	/* Periodic reports, if the controller asked for them. */
+	ue_meas_schedule(i, j);
+
 	return 0;
 }
 
@@ -358,6 +425,7 @@ int wrap_mac_report(uint32_t mod, int32_t interval, int trig_id)
 		/* Report already there */
 		if(sim_mac.mac_rep[i].mod == mod) {
 			sim_mac.mac_rep[i].interval = interval;
+			mac_rep_schedule(i);
 			return 0;
 		}
 	}
@@ -373,6 +441,10 @@ int wrap_mac_report(uint32_t mod, int32_t interval, int trig_id)
 
 	sim_mac.mac_rep[m].interval = interval;
 	sim_mac.mac_rep[m].mod      = mod;
+	sim_mac.mac_rep[m].DL_base  = sim_mac.DL_acc;
+	sim_mac.mac_rep[m].UL_base  = sim_mac.UL_acc;
+
+	mac_rep_schedule(m);
 
 	return 0;
 }
@@ -23,6 +23,12 @@
 #include <emage/emage.h>
 #include <emage/emproto.h>
 
+/* Time a trigger is considered valid before asking the agent again, in ms. The
+ * agent does not signal triggers removed by the controller, so this is the
+ * longest time reports can go on for a removed trigger.
+ */
+#define WRAP_TRIGGER_TTL		200
+
 /******************************************************************************
  * Globals used all around the simulator:                                     *
  ******************************************************************************/
@@ -31,6 +37,7 @@
 extern s32 sim_UE_rep_max;
 extern s32 sim_UE_rep_trigger;
 extern u32 sim_UE_rep_mod;
+extern u64 sim_UE_rep_chk;
 
 /* Cell statistic triggering variables. */
 extern s32 sim_cell_stats_trigger;
@@ -43,4 +50,12 @@ extern struct em_agent_ops sim_ops;
  * Public accessible procedures:                                              *
  ******************************************************************************/
 
+/* Tells if a trigger is still in place, at time 'now' in ms. The agent is
+ * asked only once 'chk', the time of the next check stored with the trigger,
+ * is reached; otherwise the trigger is taken as valid.
+ *
+ * Returns 1 if the trigger is valid, 0 otherwise.
+ */
+int wrap_trigger_valid(int tid, u64 * chk, u64 now);
+
 #endif
@@ -17,6 +17,8 @@
  * Empower Agent simulator X2 interface module.
  */
 
+/* recvmmsg() and sendmmsg() are GNU extensions. */
+#define _GNU_SOURCE
 
 #include <arpa/inet.h>
 #include <inttypes.h>
@@ -25,6 +27,7 @@
 #include <stdlib.h>
 #include <string.h>
 #include <sys/socket.h>
+#include <time.h>
 
 #include "emsim.h"
 
@@ -32,6 +35,9 @@
 
 #define X2_BUF_SIZE		1400
 
+/* Datagrams moved by a single system call. */
+#define X2_BATCH		64
+
 /******************************************************************************
  * Globals used all around the simulator:                                     *
  ******************************************************************************/
@@ -41,74 +47,762 @@ int sim_x2_fd   = 0;
 /* Port used for X2 interface */
 u16 sim_x2_port = X2_DEFAULT_PORT;
 
+/* Group where eNBs discover each other; disabled while the port is 0. */
+struct sockaddr_in sim_x2_disc = {0};
+
+/* Interval between two heartbeats to the same neighbor. */
+u32 sim_x2_hb    = X2_HB_DEFAULT;
+/* Heartbeats sent and received since start-up. */
+u64 sim_x2_hb_tx = 0;
+u64 sim_x2_hb_rx = 0;
+
+/* Outcome of the hand-overs started here. */
+u64 sim_x2_ho_done    = 0;
+u64 sim_x2_ho_fail    = 0;
+u64 sim_x2_ho_retx    = 0;
+u64 sim_x2_ho_lat     = 0;
+u64 sim_x2_ho_lat_max = 0;
+
 /******************************************************************************
  * Private procedures for X2 module only:                                     *
  ******************************************************************************/
 
-int x2_alive(struct x2_head * head, char * ipv4, unsigned short port)
+/* Datagrams received by a single system call. */
+char               x2_rx_buf[X2_BATCH][X2_BUF_SIZE];
+struct sockaddr_in x2_rx_addr[X2_BATCH];
+struct iovec       x2_rx_iov[X2_BATCH];
+struct mmsghdr     x2_rx_msg[X2_BATCH];
+
+/* The message being handled. */
+struct x2_msg      x2_rx_view;
+
+/* ALIVE message and its fan-out to the neighbors. */
+char               x2_tx_alive[X2_BUF_SIZE];
+struct iovec       x2_tx_iov;
+struct mmsghdr     x2_tx_msg[X2_BATCH];
+
+/* Slots of the neighbors with an heartbeat to send in this step. */
+int      x2_hb_due[NEIGH_MAX];
+u32      x2_nof_hb_due = 0;
+
+/* Answer given to an hand-over received. */
+typedef struct __em_sim_x2_ho_adm {
+	/* Source eNB and sequence number of the request. */
+	u64 key;
+	/* RNTI given to the UE; invalid if refused. */
+	u16 rnti;
+} x2_ho_adm;
+
+/* Sequence number of the last hand-over request sent; it starts at random,
+ * see x2_init().
+ */
+u32       x2_ho_seq = 0;
+
+/* Answers to the last X2_HO_CACHE hand-overs received, oldest overwritten
+ * first, and their index by source eNB and sequence number.
+ */
+x2_ho_adm x2_ho_cache[X2_HO_CACHE];
+u32       x2_ho_next = 0;
+em_hash   x2_ho_idx;
+
+/* UEs whose hand-over request is sent in this step. */
+int       x2_ho_due[UE_MAX];
+u32       x2_nof_ho_due = 0;
+
+/* Answers to the message being handled, sent together once it is done. */
+char                 x2_ans_buf[X2_BUF_SIZE];
+u32                  x2_ans_len  = 0;
+struct sockaddr_in * x2_ans_addr = 0;
+
+/* Socket listening on the discovery group. */
+int      x2_disc_fd = -1;
+/* Next announce on the discovery group. */
+em_timer x2_disc_tmr;
+
+int x2_send(void * buf, struct sockaddr_in * addr, unsigned int size)
 {
-	int i;
-	int f = -1;
+	return sendto(
+		sim_x2_fd,
+		buf, size,
+		0,
+		(struct sockaddr *)addr, sizeof(struct sockaddr_in));
+}
 
-	/* Somebody with our same id is contacting us!
-	 * Some serious miss-configuration is happening in the net.
+/* Starts a message of type 'type' in 'buf'; returns its length so far. */
+u32 x2_put_head(char * buf, u8 type)
+{
+	struct x2_head * hdr = (struct x2_head *)buf;
+
+	hdr->version = X2_VERSION;
+	hdr->type    = type;
+	hdr->len     = 0;
+	hdr->base_id = htonl((u32)sim_ID);
+	hdr->cell_id = htons(sim_phy.cells[0].pci);
+
+	return sizeof(struct x2_head);
+}
+
+/* Appends a TLV with 'len' bytes of value to the message in 'buf', which is
+ * '*blen' bytes long and can grow up to 'size' bytes.
+ *
+ * Returns where the value goes, or 0 if it does not fit.
+ */
+void * x2_put_tlv(char * buf, u32 * blen, u32 size, u16 type, u16 len)
+{
+	struct x2_head * hdr = (struct x2_head *)buf;
+	struct x2_tlv *  tlv = (struct x2_tlv *)(buf + *blen);
+
+	if(*blen + sizeof(struct x2_tlv) + len > size) {
+		return 0;
+	}
+
+	tlv->type = htons(type);
+	tlv->len  = htons(len);
+
+	*blen   += sizeof(struct x2_tlv) + len;
+	hdr->len = htons((u16)(*blen - sizeof(struct x2_head)));
+
+	return tlv + 1;
+}
+
+/* Size of the value of a known TLV type; 0 for unknown ones. */
+u16 x2_tlv_size(u16 type)
+{
+	switch(type) {
+	case X2_TLV_UE_CTX:
+		return sizeof(struct x2_ho);
+	case X2_TLV_HO_ANSWER:
+		return sizeof(struct x2_ho_ack);
+	case X2_TLV_DISC:
+		return sizeof(struct x2_disc);
+	case X2_TLV_LOAD:
+		return sizeof(struct x2_load);
+	}
+
+	return 0;
+}
+
+/* Checks the lengths of the datagram in 'buf', 'len' bytes long, once for
+ * all, and points 'm' to its header and known TLVs. Values stay in 'buf';
+ * longer ones, from newer eNBs, are read up to what is known here.
+ *
+ * Returns 0 on success, otherwise -1 if the message is malformed.
+ */
+int x2_parse(char * buf, int len, struct x2_msg * m)
+{
+	struct x2_tlv * tlv;
+	u32             off;
+	u32             end;
+	u16             t;
+	u16             l;
+	u16             k;
+
+	if(len < (int)sizeof(struct x2_head)) {
+		return -1;
+	}
+
+	m->head = (struct x2_head *)buf;
+	m->nof  = 0;
+
+	if(m->head->version != X2_VERSION) {
+		return -1;
+	}
+
+	end = sizeof(struct x2_head) + ntohs(m->head->len);
+
+	if(end > (u32)len) {
+		return -1;
+	}
+
+	for(off = sizeof(struct x2_head); off < end; off += l) {
+		if(off + sizeof(struct x2_tlv) > end) {
+			return -1;
+		}
+
+		tlv  = (struct x2_tlv *)(buf + off);
+		t    = ntohs(tlv->type);
+		l    = ntohs(tlv->len);
+		off += sizeof(struct x2_tlv);
+
+		if(off + l > end) {
+			return -1;
+		}
+
+		k = x2_tlv_size(t);
+
+		/* Unknown, or beyond what we look at. */
+		if(!k || m->nof == X2_TLV_MAX) {
+			continue;
+		}
+
+		if(l < k) {
+			return -1;
+		}
+
+		m->tlv[m->nof].type = t;
+		m->tlv[m->nof].len  = l;
+		m->tlv[m->nof].val  = buf + off;
+		m->nof++;
+	}
+
+	return 0;
+}
+
+/* First TLV of type 'type' in a received message, if any. */
+struct x2_view * x2_find(struct x2_msg * m, u16 type)
+{
+	u32 i;
+
+	for(i = 0; i < m->nof; i++) {
+		if(m->tlv[i].type == type) {
+			return &m->tlv[i];
+		}
+	}
+
+	return 0;
+}
+
+/* Builds the ALIVE message in 'buf', with the current load of this eNB;
+ * returns its length.
+ */
+u32 x2_put_alive(char * buf)
+{
+	u32              blen = x2_put_head(buf, X2_MSG_ALIVE);
+	struct x2_load * l    = x2_put_tlv(buf, &blen, X2_BUF_SIZE,
+		X2_TLV_LOAD, sizeof(struct x2_load));
+
+	l->ues = htons((u16)sim_nof_ues);
+
+	return blen;
+}
+
+/* Heartbeat period of a neighbor; varies a little every time, so that
+ * neighbors do not end up in step with each other.
+ */
+u32 x2_hb_period(void)
+{
+	u32 j = sim_x2_hb * X2_HB_JITTER / 100;
+
+	if(!j) {
+		return sim_x2_hb;
+	}
+
+	return sim_x2_hb - j + (u32)rand() % (2 * j + 1);
+}
+
+/* Time to send an heartbeat to a neighbor; it leaves with the others due in
+ * the same step.
+ */
+void x2_hb_timeout(em_timer * t)
+{
+	em_neigh * e = tmr_entry(t, em_neigh, hb);
+
+	if(!e->hb_due && x2_nof_hb_due < NEIGH_MAX) {
+		e->hb_due = 1;
+		x2_hb_due[x2_nof_hb_due++] = e->slot;
+	}
+
+	tmr_arm(t, x2_hb_period());
+}
+
+/* Announces this eNB on the discovery group. */
+void x2_disc_timeout(em_timer * t)
+{
+	char             buf[X2_BUF_SIZE];
+	u32              blen;
+	struct x2_disc * d;
+
+	blen = x2_put_head(buf, X2_MSG_DISCOVER);
+	d    = x2_put_tlv(buf, &blen, X2_BUF_SIZE,
+		X2_TLV_DISC, sizeof(struct x2_disc));
+
+	d->x2_port = htons(sim_x2_port);
+
+	if(sendto(x2_disc_fd, buf, blen, 0,
+		(struct sockaddr *)&sim_x2_disc,
+		sizeof(struct sockaddr_in)) < 0) {
+
+		LOG_X2("Failed to announce on the discovery group.\n");
+	}
+
+	tmr_arm(t, X2_DISC_INTERVAL);
+}
+
+/* Joins the discovery group and starts announcing this eNB. */
+int x2_disc_init(void)
+{
+	int                on   = 1;
+	struct sockaddr_in addr = {0};
+	struct ip_mreq     mr;
+
+	x2_disc_fd = socket(AF_INET, SOCK_DGRAM, 0);
+
+	if(x2_disc_fd < 0) {
+		LOG_X2("Could not create discovery socket\n");
+		return ERR_X2_DISC_SOCKET;
+	}
+
+	/* Every instance on this machine listens on the same port. */
+	setsockopt(x2_disc_fd, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on));
+#ifdef SO_REUSEPORT
+	setsockopt(x2_disc_fd, SOL_SOCKET, SO_REUSEPORT, &on, sizeof(on));
+#endif
+	setsockopt(x2_disc_fd, SOL_SOCKET, SO_BROADCAST, &on, sizeof(on));
+
+	addr.sin_family      = AF_INET;
+	addr.sin_addr.s_addr = htonl(INADDR_ANY);
+	addr.sin_port        = sim_x2_disc.sin_port;
+
+	if(bind(x2_disc_fd, (struct sockaddr *)&addr, sizeof(addr))) {
+		LOG_X2("Could not bind discovery socket\n");
+		return ERR_X2_DISC_SOCKET;
+	}
+
+	if(IN_MULTICAST(ntohl(sim_x2_disc.sin_addr.s_addr))) {
+		mr.imr_multiaddr        = sim_x2_disc.sin_addr;
+		mr.imr_interface.s_addr = htonl(INADDR_ANY);
+
+		if(setsockopt(x2_disc_fd, IPPROTO_IP, IP_ADD_MEMBERSHIP,
+			&mr, sizeof(mr))) {
+
+			LOG_X2("Could not join the discovery group\n");
+			return ERR_X2_DISC_JOIN;
+		}
+
+		/* Instances on this same machine shall hear us too. */
+		setsockopt(x2_disc_fd, IPPROTO_IP, IP_MULTICAST_LOOP,
+			&on, sizeof(on));
+	}
+
+	tmr_init(&x2_disc_tmr, x2_disc_timeout, 0);
+	tmr_arm(&x2_disc_tmr, 0);
+
+	return SUCCESS;
+}
+
+/* Key of an hand-over received in the answers index. */
+u64 x2_ho_key(u32 enb, u32 seq)
+{
+	return ((u64)enb << 32) | seq;
+}
+
+/* Sends the answers collected for the message being handled. */
+void x2_ho_reply_flush(void)
+{
+	if(x2_ans_len && x2_send(x2_ans_buf, x2_ans_addr, x2_ans_len) < 0) {
+		LOG_X2("HO: Failed to send answers\n");
+	}
+
+	x2_ans_len = 0;
+}
+
+/* Adds an answer to an hand-over request, or the release of its UE, to the
+ * ones for 'addr'; they leave together with x2_ho_reply_flush().
+ */
+void x2_ho_reply(
+	u8 type, u32 seq, u16 rnti, u16 t_rnti, struct sockaddr_in * addr)
+{
+	struct x2_ho_ack * ack = 0;
+
+	if(x2_ans_len && (
+		((struct x2_head *)x2_ans_buf)->type != type ||
+		x2_ans_addr != addr)) {
+
+		x2_ho_reply_flush();
+	}
+
+	if(x2_ans_len) {
+		ack = x2_put_tlv(x2_ans_buf, &x2_ans_len, X2_BUF_SIZE,
+			X2_TLV_HO_ANSWER, sizeof(struct x2_ho_ack));
+	}
+
+	/* Nothing collected yet, or no more room. */
+	if(!ack) {
+		x2_ho_reply_flush();
+
+		x2_ans_len  = x2_put_head(x2_ans_buf, type);
+		x2_ans_addr = addr;
+		ack         = x2_put_tlv(x2_ans_buf, &x2_ans_len, X2_BUF_SIZE,
+			X2_TLV_HO_ANSWER, sizeof(struct x2_ho_ack));
+	}
+
+	ack->seq    = htonl(seq);
+	ack->rnti   = htons(rnti);
+	ack->t_rnti = htons(t_rnti);
+}
+
+/* Remembers the answer given to an hand-over, so that it can be given again
+ * if the request is retransmitted.
+ */
+void x2_ho_admit(u64 key, u16 rnti)
+{
+	x2_ho_adm * a = &x2_ho_cache[x2_ho_next];
+
+	/* The oldest answer leaves room for this one. */
+	if(a->key && hash_get(&x2_ho_idx, a->key) == (s32)x2_ho_next) {
+		hash_del(&x2_ho_idx, a->key);
+	}
+
+	a->key  = key;
+	a->rnti = rnti;
+
+	hash_put(&x2_ho_idx, key, (s32)x2_ho_next);
+
+	x2_ho_next = (x2_ho_next + 1) % X2_HO_CACHE;
+}
+
+/* Appends the context of UE 'u', going to the neighbor in slot 'e', to the
+ * message in 'buf'.
+ *
+ * Returns 0 on success, otherwise -1 if the message is full.
+ */
+int x2_ho_put_ctx(char * buf, u32 * blen, int u, int e)
+{
+	em_phy_rs      rs;
+	struct x2_ho * ho = x2_put_tlv(buf, blen, X2_BUF_SIZE,
+		X2_TLV_UE_CTX, sizeof(struct x2_ho));
+
+	if(!ho) {
+		return -1;
+	}
+
+	ho->seq      = htonl(sim_ues[u].ho_seq);
+	ho->rnti     = htons(sim_ues[u].rnti);
+	ho->imsi     = htobe64(sim_ues[u].imsi);
+	ho->plmnid   = htonl(sim_ues[u].plmn);
+
+	/* Levels travel in dBm and dB. */
+	ho->s_rsrp   = htons((s16)phy_rsrp_from_range(
+		sim_ues[u].meas[0].rs.rsrp));
+	ho->s_rsrq   = htons((s16)phy_rsrq_from_range(
+		sim_ues[u].meas[0].rs.rsrq));
+	ue_ngh_get(u, e, &rs);
+
+	ho->t_rsrp   = htons((s16)phy_rsrp_from_range(rs.rsrp));
+	ho->t_rsrq   = htons((s16)phy_rsrq_from_range(rs.rsrq));
+
+	return 0;
+}
+
+/* Queues the hand-over request of UE 'u' for the send stage of this step,
+ * and waits for an answer a little longer at every try.
+ */
+int x2_ho_request(int u)
+{
+	if(neigh_find_id(sim_ues[u].ho_enb) < 0) {
+		LOG_X2("HO: Neighbor cell lost, enb=%u\n", sim_ues[u].ho_enb);
+		return ERR_X2_HO_CELL;
+	}
+
+	/* Out of room, it goes with the next retransmission. */
+	if(!sim_ues[u].ho_due && x2_nof_ho_due < UE_MAX) {
+		sim_ues[u].ho_due = 1;
+		x2_ho_due[x2_nof_ho_due++] = u;
+	}
+
+	tmr_arm(&sim_ues[u].ho_tmr, X2_HO_RTO << sim_ues[u].ho_tries);
+	sim_ues[u].ho_tries++;
+
+	return SUCCESS;
+}
+
+/* The hand-over of UE 'u' did not succeed; the UE stays here. */
+void x2_ho_failed(int u, int rep)
+{
+	char msg[SMALL_BUF] = {0};
+	int  mlen;
+
+	sim_x2_ho_fail++;
+
+	sim_ues[u].ho_state = UE_HO_NONE;
+	tmr_cancel(&sim_ues[u].ho_tmr);
+
+	LOG_X2("UE %x not handed over to eNB %u; %"PRIu64" failed so far.\n",
+		sim_ues[u].rnti,
+		sim_ues[u].ho_enb,
+		sim_x2_ho_fail);
+
+	/* The target eNB already told the controller, if it answered. */
+	if(!rep) {
+		return;
+	}
+
+	mlen = epf_single_ho_rep_fail(
+		msg,
+		SMALL_BUF,
+		sim_ID,
+		sim_phy.cells[0].pci,
+		sim_ues[u].ho_mod,
+		sim_ID,
+		sim_phy.cells[0].pci,
+		sim_ues[u].rnti,
+		UE_RNTI_INVALID);
+
+	if(mlen > 0) {
+		em_send(sim_ID, msg, mlen);
+	}
+}
+
+/* No answer to the hand-over request of an UE; send it again. */
+void x2_ho_timeout(em_timer * t)
+{
+	em_ue * ue = tmr_entry(t, em_ue, ho_tmr);
+	int     u  = (int)(ue - sim_ues);
+
+	if(ue->ho_tries >= X2_HO_TRIES) {
+		LOG_X2("HO: No answer from eNB %u for UE %x\n",
+			ue->ho_enb, ue->rnti);
+		x2_ho_failed(u, 1);
+		return;
+	}
+
+	sim_x2_ho_retx++;
+
+	if(x2_ho_request(u)) {
+		x2_ho_failed(u, 1);
+	}
+}
+
+/* The target eNB answered to one of our hand-over requests. */
+int x2_ho_answer(
+	struct x2_head * head, struct x2_ho_ack * ack, struct sockaddr_in * addr)
+{
+	int u;
+	u64 lat;
+
+	u = ue_find_rnti(ntohs(ack->rnti));
+
+	/* Answer to a request already answered: the release got lost. */
+	if(u < 0 ||
+		sim_ues[u].ho_state != UE_HO_PREPARING ||
+		sim_ues[u].ho_seq != ntohl(ack->seq) ||
+		sim_ues[u].ho_enb != ntohl(head->base_id)) {
+
+		if(head->type == X2_MSG_HO_ACK) {
+			x2_ho_reply(
+				X2_MSG_HO_RELEASE,
+				ntohl(ack->seq),
+				ntohs(ack->rnti),
+				ntohs(ack->t_rnti),
+				addr);
+		}
+
+		return SUCCESS;
+	}
+
+	if(head->type == X2_MSG_HO_NACK) {
+		LOG_X2("HO: eNB %u refused UE %x\n",
+			sim_ues[u].ho_enb, sim_ues[u].rnti);
+		x2_ho_failed(u, 0);
+		return SUCCESS;
+	}
+
+	lat = tmr_now() - sim_ues[u].ho_start;
+
+	sim_x2_ho_done++;
+	sim_x2_ho_lat += lat;
+
+	if(lat > sim_x2_ho_lat_max) {
+		sim_x2_ho_lat_max = lat;
+	}
+
+	LOG_X2("UE %x handed over to eNB %u as %x in %"PRIu64" ms, "
+		"after %u requests.\n",
+		sim_ues[u].rnti,
+		sim_ues[u].ho_enb,
+		ntohs(ack->t_rnti),
+		lat,
+		sim_ues[u].ho_tries);
+
+	x2_ho_reply(
+		X2_MSG_HO_RELEASE,
+		ntohl(ack->seq),
+		ntohs(ack->rnti),
+		ntohs(ack->t_rnti),
+		addr);
+
+	/* Now the UE belongs to the target eNB. */
+	ue_rem(sim_ues[u].rnti, 0);
+
+	return SUCCESS;
+}
+
+/* The source eNB released an UE we took over. */
+int x2_ho_release(struct x2_head * head, struct x2_ho_ack * ack)
+{
+	LOG_X2("HO: eNB %u released UE %x, now %x.\n",
+		ntohl(head->base_id),
+		ntohs(ack->rnti),
+		ntohs(ack->t_rnti));
+
+	/* The answer is still kept: a late copy of the request must not add
+	 * the UE twice.
 	 */
+	return SUCCESS;
+}
+
+/* An eNB announced itself on the discovery group. */
+int x2_discovered(struct x2_msg * m, struct sockaddr_in * addr)
+{
+	int                i;
+	char               ipv4[INET_ADDRSTRLEN];
+	struct x2_head *   head = m->head;
+	struct x2_view *   v    = x2_find(m, X2_TLV_DISC);
+	struct x2_disc *   d;
+	struct sockaddr_in x    = *addr;
+
+	/* Does not tell where to reach it. */
+	if(!v) {
+		return SUCCESS;
+	}
+
+	d = (struct x2_disc *)v->val;
+
+	/* Our own announce, looped back. */
 	if(ntohl(head->base_id) == sim_ID) {
-		LOG_X2("eNB id (%u) conflict with %s\n", head->base_id, ipv4);
+		return SUCCESS;
+	}
 
-		for(i = 0; i < sim_nof_neigh; i++) {
-			if(memcmp(ipv4, sim_neighs[i].ipv4, 16) == 0) {
-				sim_neighs[i].id = 0;
-				break;
-			}
+	i = neigh_find_id(ntohl(head->base_id));
+
+	if(i < 0) {
+		/* X2 messages go where the eNB said it listens. */
+		x.sin_port = d->x2_port;
+
+		inet_ntop(AF_INET, &x.sin_addr, ipv4, INET_ADDRSTRLEN);
+		LOG_X2("Discovered eNB %u at %s:%u\n",
+			ntohl(head->base_id), ipv4, ntohs(x.sin_port));
+
+		i = neigh_add_addr(
+			ntohl(head->base_id), ntohs(head->cell_id), &x);
+
+		if(i < 0) {
+			return i;
 		}
 
-		return ERR_X2_ALIVE_ME;
+		sim_neighs[i]->learnt = 1;
 	}
 
-	for(i = 0; i < sim_nof_neigh; i++) {
-		if(sim_neighs[i].id == ntohl(head->base_id)) {
-			f = i;
+	/* Announces are a sign of life as well. */
+	neigh_seen(i);
 
-			/* The cell id sent to us is always the most updated. */
-			if(sim_neighs[i].pci != ntohs(head->cell_id)) {
-				sim_neighs[i].pci = ntohs(head->cell_id);
-			}
+	return SUCCESS;
+}
+
+int x2_alive(struct x2_msg * m, struct sockaddr_in * addr)
+{
+	int              i;
+	char             ipv4[INET_ADDRSTRLEN];
+	struct x2_head * head = m->head;
+	struct x2_view * v;
+
+	/* Somebody with our same id is contacting us!
+	 * Some serious miss-configuration is happening in the net.
+	 */
+	if(ntohl(head->base_id) == sim_ID) {
+		inet_ntop(AF_INET, &addr->sin_addr, ipv4, INET_ADDRSTRLEN);
+		LOG_X2("eNB id (%u) conflict with %s\n",
+			ntohl(head->base_id), ipv4);
+
+		i = neigh_find_addr(addr);
 
-			/* Update the last time we seen it. */
-			clock_gettime(CLOCK_REALTIME, &sim_neighs[i].last_seen);
-			break;
+		if(i >= 0) {
+			neigh_rem(sim_neighs[i]->id);
 		}
+
+		return ERR_X2_ALIVE_ME;
 	}
 
+	i = neigh_find_id(ntohl(head->base_id));
+
 	/* Not found; then add it to the known eNBs. */
-	if(f < 0) {
+	if(i < 0) {
+		inet_ntop(AF_INET, &addr->sin_addr, ipv4, INET_ADDRSTRLEN);
 		LOG_X2("Not known eNB %d is contacting us from %s\n",
 			ntohl(head->base_id), ipv4);
 
-		neigh_add_ipv4(
-			ntohl(head->base_id), ntohl(head->cell_id), ipv4, port);
+		i = neigh_add_addr(
+			ntohl(head->base_id), ntohs(head->cell_id), addr);
+
+		if(i < 0) {
+			return i;
+		}
+
+		sim_neighs[i]->learnt = 1;
+	}
+
+	/* The cell id sent to us is always the most updated. */
+	sim_neighs[i]->pci = ntohs(head->cell_id);
+
+	v = x2_find(m, X2_TLV_LOAD);
+
+	if(v) {
+		sim_neighs[i]->load = ntohs(((struct x2_load *)v->val)->ues);
 	}
 
+	sim_neighs[i]->hb_rx++;
+	sim_x2_hb_rx++;
+
+	/* Update the last time we seen it, and its liveness. */
+	neigh_seen(i);
+
 	return SUCCESS;
 }
 
-int x2_handover(struct x2_head * head, char * buf, unsigned int size)
+/* Takes over the UE in context 'ho' from the eNB which sent 'head', which
+ * is in slot 'src' if known.
+ */
+int x2_ho_take(
+	struct x2_head *     head,
+	struct x2_ho *       ho,
+	int                  src,
+	struct sockaddr_in * addr)
 {
 	char		msg[SMALL_BUF] = {0};
 	int		mlen;
 
 	int 		i;
-	int		j;
+	s32		c;
+	u64		key;
+	em_phy_rs	rs;
+
+	key = x2_ho_key(ntohl(head->base_id), ntohl(ho->seq));
+	c   = hash_get(&x2_ho_idx, key);
+
+	/* Request sent again: our answer got lost, so give the same one. */
+	if(c >= 0) {
+		x2_ho_reply(
+			x2_ho_cache[c].rnti != UE_RNTI_INVALID ?
+				X2_MSG_HO_ACK : X2_MSG_HO_NACK,
+			ntohl(ho->seq),
+			ntohs(ho->rnti),
+			x2_ho_cache[c].rnti,
+			addr);
+
+		return SUCCESS;
+	}
+
+	/* Already ours, whose answer left the cache: take it over again. */
+	if((i = ue_find_imsi(be64toh(ho->imsi))) >= 0) {
+		LOG_X2("UE with IMSI=%"PRIu64" already handed over to us.\n",
+			be64toh(ho->imsi));
 
-	unsigned short 	rnti = ue_rnti_candidate();
-	struct x2_ho * 	ho = (struct x2_ho *)(buf + sizeof(struct x2_head));
+		x2_ho_admit(key, sim_ues[i].rnti);
+		x2_ho_reply(
+			X2_MSG_HO_ACK,
+			ntohl(ho->seq),
+			ntohs(ho->rnti),
+			sim_ues[i].rnti,
+			addr);
+
+		return SUCCESS;
+	}
 
 	/* Problem during receiving an HO from neighbor? */
 	if((i = ue_add(
 		sim_phy.cells[0].pci,
 		sim_phy.cells[0].DL_earfcn,
-		rnti,
+		UE_RNTI_INVALID,
 		ntohl(ho->plmnid),
 		be64toh(ho->imsi),
 		0)) < 0) {
@@ -132,26 +826,32 @@ int x2_handover(struct x2_head * head, char * buf, unsigned int size)
 	}
 
 	/* Preserve the measurement done by the UE before HO. */
-	sim_ues[i].meas[0].rs.rsrp = (s16)(ntohs(ho->t_rsrp));
-	sim_ues[i].meas[0].rs.rsrq = (s16)(ntohs(ho->t_rsrq));
-
-	for(j = 0; j < NEIGH_MAX; j++) {
-		/* Preserve the measurement done by the UE before HO. */
-		if(sim_neighs[j].pci == ntohs(head->cell_id)) {
-			sim_neighs[j].rs[i].rsrq = (s16)(ntohs(ho->s_rsrq));
-			sim_neighs[j].rs[i].rsrp = (s16)(ntohs(ho->s_rsrp));
-		} else {
-			sim_neighs[j].rs[i].rsrq = PHY_RSRQ_LOWER;
-			sim_neighs[j].rs[i].rsrp = PHY_RSRP_LOWER;
-		}
+	sim_ues[i].meas[0].rs.rsrp =
+		phy_rsrp_to_range((s16)(ntohs(ho->t_rsrp)));
+	sim_ues[i].meas[0].rs.rsrq =
+		phy_rsrq_to_range((s16)(ntohs(ho->t_rsrq)));
+
+	/* The new UE hears no neighbor but the source one. */
+	rs.rsrp = phy_rsrp_to_range((s16)(ntohs(ho->s_rsrp)));
+	rs.rsrq = phy_rsrq_to_range((s16)(ntohs(ho->s_rsrq)));
+
+	/* Preserve the measurement done by the UE before HO. */
+	if(src >= 0) {
+		ue_ngh_set(i, src, &rs);
 	}
-#if 1
-	sim_switch = !sim_switch;
-#endif
+
 	LOG_X2("UE with IMSI=%"PRIu64" handed over to us by eNB %d.\n",
 		be64toh(ho->imsi),
 		ntohl(head->base_id));
 
+	x2_ho_admit(key, sim_ues[i].rnti);
+	x2_ho_reply(
+		X2_MSG_HO_ACK,
+		ntohl(ho->seq),
+		ntohs(ho->rnti),
+		sim_ues[i].rnti,
+		addr);
+
 	return SUCCESS;
 
 ho_err:
@@ -164,7 +864,7 @@ ho_err:
 		ntohl(head->base_id),
 		ntohs(head->cell_id),
 		ntohs(ho->rnti),
-		rnti);
+		UE_RNTI_INVALID);
 
 	if(mlen > 0) {
 		em_send(sim_ID, msg, mlen);
@@ -174,16 +874,270 @@ ho_err:
 		be64toh(ho->imsi),
 		ntohl(head->base_id));
 
+	x2_ho_admit(key, UE_RNTI_INVALID);
+	x2_ho_reply(
+		X2_MSG_HO_NACK,
+		ntohl(ho->seq),
+		ntohs(ho->rnti),
+		UE_RNTI_INVALID,
+		addr);
+
 	return SUCCESS;
 }
 
-int x2_send(void * buf, struct sockaddr_in * addr, unsigned int size)
+/* Takes over all the UEs of an hand-over message, and answers for all of
+ * them together.
+ */
+int x2_handover(struct x2_msg * m, struct sockaddr_in * addr)
 {
-	return sendto(
-		sim_x2_fd,
-		buf, size,
-		0,
-		(struct sockaddr *)addr, sizeof(struct sockaddr_in));
+	u32 i;
+	int src = neigh_find_id(ntohl(m->head->base_id));
+
+	for(i = 0; i < m->nof; i++) {
+		if(m->tlv[i].type == X2_TLV_UE_CTX) {
+			x2_ho_take(m->head,
+				(struct x2_ho *)m->tlv[i].val, src, addr);
+		}
+	}
+
+	x2_ho_reply_flush();
+
+	return SUCCESS;
+}
+
+/* Handles a datagram of 'len' bytes received from 'addr'. Its lengths are
+ * checked once, then the values are read where they are.
+ */
+void x2_dispatch(char * buf, int len, struct sockaddr_in * addr)
+{
+	struct x2_msg * m = &x2_rx_view;
+	u32             i;
+
+	if(x2_parse(buf, len, m)) {
+		return;
+	}
+
+	switch(m->head->type) {
+	case X2_MSG_ALIVE:
+		x2_alive(m, addr);
+		break;
+	case X2_MSG_HANDOVER:
+		x2_handover(m, addr);
+		break;
+	case X2_MSG_HO_ACK:
+	case X2_MSG_HO_NACK:
+		for(i = 0; i < m->nof; i++) {
+			if(m->tlv[i].type == X2_TLV_HO_ANSWER) {
+				x2_ho_answer(m->head,
+					(struct x2_ho_ack *)m->tlv[i].val, addr);
+			}
+		}
+
+		/* Releases of all the UEs answered. */
+		x2_ho_reply_flush();
+		break;
+	case X2_MSG_HO_RELEASE:
+		for(i = 0; i < m->nof; i++) {
+			if(m->tlv[i].type == X2_TLV_HO_ANSWER) {
+				x2_ho_release(m->head,
+					(struct x2_ho_ack *)m->tlv[i].val);
+			}
+		}
+		break;
+	case X2_MSG_DISCOVER:
+		x2_discovered(m, addr);
+		break;
+	}
+}
+
+/* Receives and handles all the datagrams pending on socket 'fd', up to
+ * X2_BATCH per system call.
+ */
+void x2_recv(int fd)
+{
+	int i;
+	int n;
+
+	do {
+		/* The kernel writes here the size of the addresses. */
+		for(i = 0; i < X2_BATCH; i++) {
+			x2_rx_msg[i].msg_hdr.msg_namelen =
+				sizeof(struct sockaddr_in);
+		}
+
+		n = recvmmsg(fd, x2_rx_msg, X2_BATCH, MSG_DONTWAIT, 0);
+
+		for(i = 0; i < n; i++) {
+			x2_dispatch(
+				x2_rx_buf[i],
+				(int)x2_rx_msg[i].msg_len,
+				&x2_rx_addr[i]);
+		}
+	} while(n == X2_BATCH);
+}
+
+/* Sends the ALIVE message to the neighbors with an heartbeat due, up to
+ * X2_BATCH per system call. Their addresses are resolved when they are added.
+ */
+void x2_hb_send(void)
+{
+	u32 i;
+	u32 c;
+	u32 n;
+	int r;
+
+	x2_tx_iov.iov_len = x2_put_alive(x2_tx_alive);
+
+	/* Drop the ones stopped after their heartbeat was due. */
+	for(i = 0, c = 0; i < x2_nof_hb_due; i++) {
+		if(sim_neighs[x2_hb_due[i]]->hb_due) {
+			sim_neighs[x2_hb_due[i]]->hb_due = 0;
+			x2_hb_due[c++] = x2_hb_due[i];
+		}
+	}
+
+	x2_nof_hb_due = c;
+
+	for(n = 0; n < x2_nof_hb_due; ) {
+		c = x2_nof_hb_due - n < X2_BATCH ? x2_nof_hb_due - n : X2_BATCH;
+
+		for(i = 0; i < c; i++) {
+			x2_tx_msg[i].msg_hdr.msg_name =
+				&sim_neighs[x2_hb_due[n + i]]->saddr;
+		}
+
+		r = sendmmsg(sim_x2_fd, x2_tx_msg, c, 0);
+
+		/* The first message failed; skip it and go on with the rest. */
+		if(r <= 0) {
+			LOG_X2("Failed to present to neighbor %u.\n",
+				sim_neighs[x2_hb_due[n]]->id);
+			n++;
+			continue;
+		}
+
+		for(i = 0; i < (u32)r; i++) {
+			sim_neighs[x2_hb_due[n + i]]->hb_tx++;
+		}
+
+		sim_x2_hb_tx += (u32)r;
+		n += (u32)r;
+	}
+
+	x2_nof_hb_due = 0;
+}
+
+/* Orders the UEs to hand over by target eNB. */
+int x2_ho_cmp(const void * a, const void * b)
+{
+	u32 x = sim_ues[*(const int *)a].ho_enb;
+	u32 y = sim_ues[*(const int *)b].ho_enb;
+
+	return x < y ? -1 : x > y;
+}
+
+/* Sends an hand-over message to the neighbor in slot 'e', if it carries any
+ * UE.
+ */
+void x2_ho_flush(char * buf, u32 blen, int e)
+{
+	if(e < 0 || blen <= sizeof(struct x2_head)) {
+		return;
+	}
+
+	/* A lost datagram is recovered by the retransmission. */
+	if(x2_send(buf, &sim_neighs[e]->saddr, blen) < 0) {
+		LOG_X2("HO: Failed to send requests to eNB %u\n",
+			sim_neighs[e]->id);
+	}
+}
+
+/* Sends the hand-over requests queued in this step. UEs going to the same
+ * eNB are packed in as few datagrams as they fit in.
+ */
+void x2_ho_send(void)
+{
+	char buf[X2_BUF_SIZE];
+	u32  blen = 0;
+	u32  enb  = NEIGH_INVALID_ID;
+	u32  i;
+	u32  c;
+	int  u;
+	int  e    = -1;
+
+	/* Drop the UEs gone, or answered, after their request was queued. */
+	for(i = 0, c = 0; i < x2_nof_ho_due; i++) {
+		u = x2_ho_due[i];
+
+		if(sim_ues[u].ho_due && sim_ues[u].ho_state == UE_HO_PREPARING) {
+			sim_ues[u].ho_due = 0;
+			x2_ho_due[c++]    = u;
+		}
+	}
+
+	x2_nof_ho_due = 0;
+
+	if(!c) {
+		return;
+	}
+
+	qsort(x2_ho_due, c, sizeof(int), x2_ho_cmp);
+
+	for(i = 0; i < c; i++) {
+		u = x2_ho_due[i];
+
+		if(sim_ues[u].ho_enb != enb) {
+			x2_ho_flush(buf, blen, e);
+
+			enb  = sim_ues[u].ho_enb;
+			e    = neigh_find_id(enb);
+			blen = x2_put_head(buf, X2_MSG_HANDOVER);
+		}
+
+		/* Removed after the request was queued. */
+		if(e < 0) {
+			LOG_X2("HO: Neighbor cell lost, enb=%u\n", enb);
+			x2_ho_failed(u, 1);
+			continue;
+		}
+
+		/* Full; this UE starts the next datagram. */
+		if(x2_ho_put_ctx(buf, &blen, u, e)) {
+			x2_ho_flush(buf, blen, e);
+
+			blen = x2_put_head(buf, X2_MSG_HANDOVER);
+			x2_ho_put_ctx(buf, &blen, u, e);
+		}
+	}
+
+	x2_ho_flush(buf, blen, e);
+}
+
+/* Links the batches of messages with their buffers, once for all. */
+void x2_batch_init(void)
+{
+	int i;
+
+	for(i = 0; i < X2_BATCH; i++) {
+		x2_rx_iov[i].iov_base = x2_rx_buf[i];
+		x2_rx_iov[i].iov_len  = X2_BUF_SIZE;
+
+		memset(&x2_rx_msg[i], 0, sizeof(struct mmsghdr));
+		x2_rx_msg[i].msg_hdr.msg_name    = &x2_rx_addr[i];
+		x2_rx_msg[i].msg_hdr.msg_namelen = sizeof(struct sockaddr_in);
+		x2_rx_msg[i].msg_hdr.msg_iov     = &x2_rx_iov[i];
+		x2_rx_msg[i].msg_hdr.msg_iovlen  = 1;
+	}
+
+	x2_tx_iov.iov_base = x2_tx_alive;
+	x2_tx_iov.iov_len  = 0;
+
+	for(i = 0; i < X2_BATCH; i++) {
+		memset(&x2_tx_msg[i], 0, sizeof(struct mmsghdr));
+		x2_tx_msg[i].msg_hdr.msg_namelen = sizeof(struct sockaddr_in);
+		x2_tx_msg[i].msg_hdr.msg_iov     = &x2_tx_iov;
+		x2_tx_msg[i].msg_hdr.msg_iovlen  = 1;
+	}
 }
 
 /******************************************************************************
@@ -193,8 +1147,23 @@ int x2_send(void * buf, struct sockaddr_in * addr, unsigned int size)
 int x2_init()
 {
 	int status = 0;
+	struct timespec ts;
 	struct sockaddr_in addr = {0};
 
+	x2_batch_init();
+
+	/* Neighbors remember the answers to our last requests by sequence
+	 * number: after a restart they must not take new requests for old ones.
+	 * The clock tells apart restarts within the same second of srand().
+	 */
+	clock_gettime(CLOCK_REALTIME, &ts);
+	x2_ho_seq = (u32)rand() ^ (u32)ts.tv_nsec;
+
+	if(hash_init(&x2_ho_idx, X2_HO_CACHE)) {
+		LOG_X2("Could not allocate the hand-over index\n");
+		return ERR_X2_INIT_INDEX;
+	}
+
 	sim_x2_fd = socket(AF_INET, SOCK_DGRAM, 0);
 
 	if(sim_x2_fd < 0) {
@@ -217,19 +1186,18 @@ int x2_init()
 		return ERR_X2_INIT_BIND;
 	}
 
+	/* Optional discovery of the neighbors. */
+	if(sim_x2_disc.sin_port) {
+		return x2_disc_init();
+	}
+
 	return SUCCESS;
 }
 
-int x2_hand_over(u16 rnti, u64 enb)
+int x2_hand_over(u16 rnti, u64 enb, u32 mod)
 {
-	int i;
-	int u = -1;
-	int e = -1;
-
-	char buf[64] = {0};
-
-	struct x2_head * hdr = (struct x2_head *)buf;
-	struct x2_ho * ho    = (struct x2_ho *)(buf + sizeof(struct x2_head));
+	int u;
+	int e;
 
 	if(enb == NEIGH_INVALID_ID) {
 		return ERR_X2_HO_CELL;
@@ -239,133 +1207,129 @@ int x2_hand_over(u16 rnti, u64 enb)
 		return ERR_X2_HO_UE;
 	}
 
-	for(i = 0; i < UE_MAX; i++) {
-		if(sim_ues[i].rnti == rnti) {
-			u = i;
-			break;
-		}
-	}
-
-	for(i = 0; i < NEIGH_MAX; i++) {
-		if(sim_neighs[i].id == (u32)enb) {
-			e = i;
-			break;
-		}
-	}
+	u = ue_find_rnti(rnti);
+	e = neigh_find_id((u32)enb);
 
 	if(e < 0) {
 		LOG_X2("HO: Neighbor cell not found, enb=%u\n", (u32)enb);
 		return ERR_X2_HO_CELL;
 	}
 
+	if(sim_neighs[e]->state == NEIGH_STATE_DEAD) {
+		LOG_X2("HO: Neighbor cell is dead, enb=%u\n", (u32)enb);
+		return ERR_X2_HO_CELL;
+	}
+
 	if(u < 0 ) {
 		LOG_X2("HO: UE not found, ue=%u\n", rnti);
 		return ERR_X2_HO_UE;
 	}
 
-	hdr->base_id = htonl((u32)sim_ID);
-	hdr->cell_id = htons(sim_phy.cells[0].pci);
-	hdr->type    = X2_MSG_HANDOVER;
+	if(sim_ues[u].ho_state != UE_HO_NONE) {
+		LOG_X2("HO: UE %x already handed over to eNB %u\n",
+			rnti, sim_ues[u].ho_enb);
+		return ERR_X2_HO_BUSY;
+	}
 
-	ho->rnti     = htons(sim_ues[u].rnti);
-	ho->imsi     = htobe64(sim_ues[u].imsi);
-	ho->plmnid   = htonl(sim_ues[u].plmn);
+	LOG_X2("Handing over UE %x to eNB %d\n", rnti, (u32)enb);
 
-	ho->s_rsrp   = htons((s16)(sim_ues[u].meas[0].rs.rsrp));
-	ho->s_rsrq   = htons((s16)(sim_ues[u].meas[0].rs.rsrq));
-	ho->t_rsrp   = htons((s16)(sim_neighs[e].rs[u].rsrp));
-	ho->t_rsrq   = htons((s16)(sim_neighs[e].rs[u].rsrq));
+	sim_ues[u].ho_state = UE_HO_PREPARING;
+	sim_ues[u].ho_seq   = ++x2_ho_seq;
+	sim_ues[u].ho_enb   = (u32)enb;
+	sim_ues[u].ho_mod   = mod;
+	sim_ues[u].ho_tries = 0;
+	sim_ues[u].ho_start = tmr_now();
+	tmr_init(&sim_ues[u].ho_tmr, x2_ho_timeout, 0);
 
-	LOG_X2("Handing over UE %x to eNB %d\n", rnti, (u32)enb);
+	return x2_ho_request(u);
+}
+
+int x2_hand_over_group(u16 * rnti, u32 nof, u64 enb, u32 mod)
+{
+	u32 i;
+	int n = 0;
 
-	x2_send(
-		buf,
-		&sim_neighs[e].saddr,
-		sizeof(struct x2_head) + sizeof(struct x2_ho));
+	/* Requests are only queued here, and leave together with the send
+	 * stage of this step.
+	 */
+	for(i = 0; i < nof; i++) {
+		if(!x2_hand_over(rnti[i], enb, mod)) {
+			n++;
+		}
+	}
+
+	LOG_X2("Handing over %d of %u UEs to eNB %u\n", n, nof, (u32)enb);
+
+	return n;
+}
+
+int x2_present(int n)
+{
+	char buf[X2_BUF_SIZE];
+	u32  blen = x2_put_alive(buf);
+
+	if(x2_send(buf, &sim_neighs[n]->saddr, blen) < 0) {
+		LOG_X2("Failed to present to neighbor %u.\n", sim_neighs[n]->id);
+		return ERR_X2_PRESENT;
+	}
+
+	sim_neighs[n]->hb_tx++;
+	sim_x2_hb_tx++;
 
 	return SUCCESS;
 }
 
+void x2_hb_start(int n)
+{
+	em_neigh * e = sim_neighs[n];
+
+	e->hb_due = 0;
+	tmr_init(&e->hb, x2_hb_timeout, 0);
+
+	/* Random phase within the period. */
+	tmr_arm(&e->hb, (u32)rand() % sim_x2_hb);
+}
+
+void x2_hb_stop(int n)
+{
+	/* Already in the list of this step, if due: skipped when sending. */
+	sim_neighs[n]->hb_due = 0;
+	tmr_cancel(&sim_neighs[n]->hb);
+}
+
 /******************************************************************************
  * X2 simulation logic:                                                       *
  ******************************************************************************/
 
 u32 x2_compute()
 {
-	int i;
-	int ret;
-
-	char addr[INET_ADDRSTRLEN] = {0};
-	char buf[X2_BUF_SIZE] = {0};
-
-	struct x2_head * h;
-	struct x2_head j;
-
-	struct sockaddr_in sa;
-	/* NOTE: This must be set with the address size to work. */
-	socklen_t sa_len = sizeof(struct sockaddr_in);
-
 	/*
 	 * Receive stage:
 	 */
 
 	/* Continue as long as there are received packets.
 	 *
-	 * NOTE: I don't expect X2 to be frequently used, so this should not
-	 * consume lot of resources and does not need a custom thread.
+	 * NOTE: Datagrams are taken in batches, so that a step costs a couple
+	 * of system calls however many neighbors are there.
 	 */
-	do {
-		ret = recvfrom(
-			sim_x2_fd,
-			buf,
-			X2_BUF_SIZE,
-			MSG_DONTWAIT | MSG_NOSIGNAL,
-			(struct sockaddr *)&sa, &sa_len);
-
-		/* DONTWAIT can returns immediately with -1. */
-		if(ret > 0) {
-			h = (struct x2_head *)buf;
-
-			switch(h->type) {
-			case X2_MSG_ALIVE:
-				/* Translate the IP to human readable one. */
-				inet_ntop(
-					AF_INET,
-					&(sa.sin_addr),
-					addr,
-					INET_ADDRSTRLEN);
-
-				x2_alive(h, addr, ntohs(sa.sin_port));
-				break;
-			case X2_MSG_HANDOVER:
-				x2_handover(h, buf, ret);
-				break;
-			}
-		}
-	} while(ret > 0);
+	x2_recv(sim_x2_fd);
+
+	/* Announces of other eNBs on the discovery group. */
+	if(x2_disc_fd >= 0) {
+		x2_recv(x2_disc_fd);
+	}
 
 	/*
 	 * Send stage:
 	 */
 
-	for(i = 0; i < NEIGH_MAX; i++) {
-		/* Only if its a valid one. */
-		if(sim_neighs[i].id) {
-			j.base_id = htonl((u32)sim_ID);
-			j.cell_id = htons(sim_phy.cells[0].pci);
-			j.type = X2_MSG_ALIVE;
-
-			/* Send the 'I'm alive' message. */
-			ret = x2_send(
-				&j,
-				&sim_neighs[i].saddr,
-				sizeof(struct x2_head));
-
-			if(ret < 0) {
-			       LOG_X2("Failed to present to neighbor cells.\n");
-			}
-		}
-	}
+	/* Send the 'I'm alive' message to the neighbors due in this step; dead
+	 * neighbors are probed apart.
+	 */
+	x2_hb_send();
+
+	/* Hand-overs started in this step, or sent again. */
+	x2_ho_send();
 
 	return SUCCESS;
 }
@@ -22,6 +22,32 @@
 
 #define X2_DEFAULT_PORT		9999
 
+/* Version of the X2 framing; messages of other versions are dropped. */
+#define X2_VERSION		1
+/* TLVs looked at in a single message; the others are ignored. */
+#define X2_TLV_MAX		128
+
+/* Port of the discovery group, if not given. */
+#define X2_DISC_PORT		9998
+/* Interval between two announces on the discovery group, in ms. */
+#define X2_DISC_INTERVAL	1000
+
+/* Interval between two heartbeats to the same neighbor, in ms. */
+#define X2_HB_DEFAULT		1000
+/* Maximum deviation of each heartbeat from its period, in percent. */
+#define X2_HB_JITTER		10
+
+/* Time to wait for the answer to the first hand-over request, in ms; it
+ * doubles at every retransmission.
+ */
+#define X2_HO_RTO		200
+/* Requests sent before giving up on an hand-over. */
+#define X2_HO_TRIES		4
+/* Hand-overs received whose answer is kept for retransmitted requests; a
+ * bulk hand-over of every UE, each sent up to X2_HO_TRIES times, must fit.
+ */
+#define X2_HO_CACHE		(UE_MAX * X2_HO_TRIES)
+
 /* Type of message that can be recognized on X2 interface. */
 enum x2_message_types {
 	/* Invalid type. */
@@ -30,12 +56,42 @@ enum x2_message_types {
 	X2_MSG_ALIVE,
 	/* The message contains hand-over information. */
 	X2_MSG_HANDOVER,
+	/* Announces this eNB on the discovery group. */
+	X2_MSG_DISCOVER,
+	/* The target eNB took the UE over. */
+	X2_MSG_HO_ACK,
+	/* The target eNB refused the UE. */
+	X2_MSG_HO_NACK,
+	/* The source eNB released the UE context. */
+	X2_MSG_HO_RELEASE,
+};
+
+/* Type of the TLVs which follow the header of a message. Unknown types are
+ * skipped, so that new ones can be added without breaking older eNBs.
+ */
+enum x2_tlv_types {
+	/* Invalid type. */
+	X2_TLV_INVALID = 0,
+	/* Context of an UE being handed over, as struct x2_ho. */
+	X2_TLV_UE_CTX,
+	/* Answer about an UE being handed over, as struct x2_ho_ack. */
+	X2_TLV_HO_ANSWER,
+	/* Where the eNB listens, as struct x2_disc. */
+	X2_TLV_DISC,
+	/* Load of the eNB, as struct x2_load. */
+	X2_TLV_LOAD,
 };
 
 /* Header of X2 packets. */
 struct x2_head {
+	/* Version of the framing. */
+	u8 version;
 	/* Type of packet. */
 	u8 type;
+	/* Bytes of TLVs which follow the header.
+	 * NOTE: This is sent in network order.
+	 */
+	u16 len;
 	/* Base station id which generated this message.
 	 * NOTE: This is sent in network order.
 	 */
@@ -46,8 +102,24 @@ struct x2_head {
 	u16 cell_id;
 }__attribute__((packed));
 
+/* Header of a TLV; 'len' bytes of value follow. */
+struct x2_tlv {
+	/* Type of the value.
+	 * NOTE: This is sent in network order.
+	 */
+	u16 type;
+	/* Bytes of the value.
+	 * NOTE: This is sent in network order.
+	 */
+	u16 len;
+}__attribute__((packed));
+
 /* Information of the hand-over operation. */
 struct x2_ho {
+	/* Sequence number of the request, same in retransmissions.
+	 * NOTE: This is sent in network order.
+	 */
+	u32 seq;
 	/* The old RNTI */
 	u16 rnti;
 	/* UE IMSI unique id.
@@ -68,12 +140,85 @@ struct x2_ho {
 	s16 t_rsrq;
 }__attribute__((packed));
 
+/* Answer to an hand-over request, or release of the UE context. */
+struct x2_ho_ack {
+	/* Sequence number of the request.
+	 * NOTE: This is sent in network order.
+	 */
+	u32 seq;
+	/* RNTI of the UE in the source eNB.
+	 * NOTE: This is sent in network order.
+	 */
+	u16 rnti;
+	/* RNTI of the UE in the target eNB; invalid if refused.
+	 * NOTE: This is sent in network order.
+	 */
+	u16 t_rnti;
+}__attribute__((packed));
+
+/* Announce on the discovery group. */
+struct x2_disc {
+	/* Port where the X2 interface of the eNB listens.
+	 * NOTE: This is sent in network order.
+	 */
+	u16 x2_port;
+}__attribute__((packed));
+
+/* Load of the eNB. */
+struct x2_load {
+	/* UEs attached to the eNB.
+	 * NOTE: This is sent in network order.
+	 */
+	u16 ues;
+}__attribute__((packed));
+
+/* A TLV of a received message, left in the receive buffer. */
+struct x2_view {
+	/* Type of the value, in host order. */
+	u16    type;
+	/* Bytes of the value, at least the size of its structure. */
+	u16    len;
+	/* The value itself. */
+	char * val;
+};
+
+/* A received message, checked once for its lengths. */
+struct x2_msg {
+	/* Header of the message. */
+	struct x2_head * head;
+	/* Known TLVs of the message, in the order they came. */
+	u32              nof;
+	struct x2_view   tlv[X2_TLV_MAX];
+};
+
 /******************************************************************************
  * Globals used all around the simulator:                                     *
  ******************************************************************************/
 
 extern unsigned short sim_x2_port;
 
+/* Multicast or broadcast group where eNBs discover each other; no discovery
+ * if the port is 0.
+ */
+extern struct sockaddr_in sim_x2_disc;
+
+/* Interval between two heartbeats to the same neighbor, in ms. */
+extern u32 sim_x2_hb;
+
+/* Heartbeats sent to and received from all the neighbors. */
+extern u64 sim_x2_hb_tx;
+extern u64 sim_x2_hb_rx;
+
+/* Hand-overs acknowledged by the target eNB. */
+extern u64 sim_x2_ho_done;
+/* Hand-overs refused by the target eNB or never answered. */
+extern u64 sim_x2_ho_fail;
+/* Hand-over requests sent again. */
+extern u64 sim_x2_ho_retx;
+/* Sum and maximum of the hand-over latencies, in ms. */
+extern u64 sim_x2_ho_lat;
+extern u64 sim_x2_ho_lat_max;
+
 /******************************************************************************
  * Public accessible procedures:                                              *
  ******************************************************************************/
@@ -84,11 +229,34 @@ extern unsigned short sim_x2_port;
  */
 int x2_init(void);
 
-/* Send hand over an UE to a certain neighbor cell.
+/* Starts handing an UE over to a certain neighbor cell. The UE stays here
+ * until the neighbor acknowledges it, and the request is sent again if no
+ * answer comes; 'mod' is told of the failure if the neighbor never answers.
+ *
+ * Return 0 on success, otherwise a negative error code.
+ */
+int x2_hand_over(u16 rnti, u64 enb, u32 mod);
+
+/* Starts handing 'nof' UEs over to a certain neighbor cell at once; their
+ * contexts travel packed in as few datagrams as they fit in.
+ *
+ * Returns the number of UEs whose hand-over started.
+ */
+int x2_hand_over_group(u16 * rnti, u32 nof, u64 enb, u32 mod);
+
+/* Send an ALIVE message to the neighbor in slot 'n'.
  *
  * Return 0 on success, otherwise a negative error code.
  */
-int x2_hand_over(u16 rnti, u64 enb);
+int x2_present(int n);
+
+/* Starts sending heartbeats to the neighbor in slot 'n', at a random phase
+ * of the period so that neighbors are not all served in the same step.
+ */
+void x2_hb_start(int n);
+
+/* Stops sending heartbeats to the neighbor in slot 'n'. */
+void x2_hb_stop(int n);
 
 /******************************************************************************
  * X2 simulation logic:                                                       *